@@ -0,0 +1,551 @@
+/* @(#) $Id$ */
+
+/*
+ * Copyright (c) 2003, 2004, 2005, 2006, 2007, 2008 Mo McRoberts.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) of this software may not be used to endorse
+ *    or promote products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY 
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * AUTHORS OF THIS SOFTWARE BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF 
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS 
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* edi-codegen: generate specialised serialisers from message specifications.
+ *
+ * Usage: edi-codegen [-p PARAMS] [-o OUTPUT] [SPEC]
+ *
+ * PARAMS names a set of registered parameters (default "UN/EDIFACT"), whose
+ * separators and escaping rules are compiled into the generated code. SPEC
+ * (default standard input) is read one directive per line:
+ *
+ *   # comment
+ *   include "header.h"      #include written into the output
+ *   message NAME TYPE...    begin size_t NAME(const TYPE *m, char *buf,
+ *                           size_t buflen)
+ *   segment TAG             begin a segment
+ *   element COMP[:COMP...]  add a data element to the current segment
+ *   end                     end the current message
+ *
+ * Each COMP is either a "quoted literal", a member of TYPE holding a
+ * NUL-terminated string (NULL is written as empty), a member followed by
+ * '#' holding an integer, or empty. The generated function writes the
+ * message into @buf without building an interchange: tags, separators and
+ * literals are escaped when the code is generated and copied as whole runs,
+ * and only member values are examined at runtime. Like snprintf(), it
+ * returns the length of the complete message, stores as much as fits, and
+ * NUL-terminates the output if there is room.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "libedi.h"
+
+#define LINE_MAX_LEN                    1024
+
+typedef struct codegen_struct codegen_t;
+
+struct codegen_struct
+{
+	const char *specname;
+	unsigned long lineno;
+	const edi_params_t *params;
+	unsigned char specials[5];
+	size_t nspecials;
+	/* Generated function bodies, written after the helpers */
+	char *body;
+	size_t bodylen;
+	size_t bodyalloc;
+	/* Pending literal octets, already escaped */
+	char lit[LINE_MAX_LEN * 4];
+	size_t litlen;
+	int inmessage;
+	int insegment;
+	int nelements;
+	int usestr;
+	int uselong;
+};
+
+static const char *progname = "edi-codegen";
+
+static void
+fail(codegen_t *cg, const char *msg, const char *arg)
+{
+	if(cg->lineno)
+	{
+		fprintf(stderr, "%s:%lu: %s%s%s\n", cg->specname, cg->lineno, msg, (arg ? ": " : ""), (arg ? arg : ""));
+	}
+	else
+	{
+		fprintf(stderr, "%s: %s%s%s\n", progname, msg, (arg ? ": " : ""), (arg ? arg : ""));
+	}
+	exit(EXIT_FAILURE);
+}
+
+/* Append @len octets of @s to the generated function bodies */
+static void
+out(codegen_t *cg, const char *s, size_t len)
+{
+	char *p;
+	size_t n;
+	
+	if(cg->bodylen + len > cg->bodyalloc)
+	{
+		n = (cg->bodyalloc ? cg->bodyalloc * 2 : 4096);
+		while(n < cg->bodylen + len)
+		{
+			n *= 2;
+		}
+		if(NULL == (p = (char *) realloc(cg->body, n)))
+		{
+			fail(cg, "out of memory", NULL);
+		}
+		cg->body = p;
+		cg->bodyalloc = n;
+	}
+	memcpy(cg->body + cg->bodylen, s, len);
+	cg->bodylen += len;
+}
+
+static void
+outs(codegen_t *cg, const char *s)
+{
+	out(cg, s, strlen(s));
+}
+
+/* Render @len octets of @s into @dest, which must have room for at least
+ * 4 * @len + 1 octets, as the contents of a C string literal.
+ */
+static char *
+cstring(char *dest, const unsigned char *s, size_t len)
+{
+	char *p;
+	size_t c;
+	
+	for(p = dest, c = 0; c < len; c++)
+	{
+		if('"' == s[c] || '\\' == s[c])
+		{
+			*p++ = '\\';
+			*p++ = s[c];
+		}
+		else if(isprint(s[c]) && '?' != s[c])
+		{
+			*p++ = s[c];
+		}
+		else
+		{
+			/* Always three digits, so that a following digit can't be
+			 * taken as part of the sequence; '?' is written this way to
+			 * avoid forming trigraphs.
+			 */
+			sprintf(p, "\\%03o", s[c]);
+			p += 4;
+		}
+	}
+	*p = 0;
+	return dest;
+}
+
+/* Append @ch to the pending literal run, escaping it if needed */
+static void
+literal_char(codegen_t *cg, unsigned char ch, int escape)
+{
+	if(cg->litlen + 2 > sizeof(cg->lit))
+	{
+		fail(cg, "literal run too long", NULL);
+	}
+	if(escape && cg->params->escape && NULL != memchr(cg->specials, ch, cg->nspecials))
+	{
+		cg->lit[cg->litlen++] = cg->params->escape;
+	}
+	cg->lit[cg->litlen++] = ch;
+}
+
+/* Emit the pending literal run as a single copy */
+static void
+flush(codegen_t *cg)
+{
+	char buf[sizeof(cg->lit) * 4 + 1];
+	
+	if(!cg->litlen)
+	{
+		return;
+	}
+	outs(cg, "\tpos = edigen_raw(buf, buflen, pos, \"");
+	outs(cg, cstring(buf, (const unsigned char *) cg->lit, cg->litlen));
+	sprintf(buf, "\", %lu);\n", (unsigned long) cg->litlen);
+	outs(cg, buf);
+	cg->litlen = 0;
+}
+
+static void
+end_segment(codegen_t *cg)
+{
+	const char *nl;
+	
+	if(!cg->insegment)
+	{
+		return;
+	}
+	literal_char(cg, cg->params->segment_separator, 0);
+	nl = (0x0104 <= cg->params->version ? cg->params->segment_newline : NULL);
+	for(; NULL != nl && *nl; nl++)
+	{
+		literal_char(cg, (unsigned char) *nl, 0);
+	}
+	cg->insegment = 0;
+}
+
+/* Return the length of the identifier at @s, failing if there is none */
+static size_t
+ident(codegen_t *cg, const char *s)
+{
+	size_t n;
+	
+	/* Nested members (a.b, a->b) are permitted */
+	for(n = 0; ; n++)
+	{
+		if('-' == s[n] && '>' == s[n + 1])
+		{
+			n++;
+		}
+		else if(!isalnum((unsigned char) s[n]) && '_' != s[n] && '.' != s[n])
+		{
+			break;
+		}
+	}
+	if(!n || isdigit((unsigned char) s[0]))
+	{
+		fail(cg, "expected a member name", s);
+	}
+	return n;
+}
+
+/* Parse the component list of an element directive at @s */
+static void
+element(codegen_t *cg, const char *s)
+{
+	size_t n;
+	int first;
+	
+	if(!cg->insegment)
+	{
+		fail(cg, "element outside of a segment", NULL);
+	}
+	literal_char(cg, (cg->nelements ? cg->params->element_separator : cg->params->tag_separator), 0);
+	cg->nelements++;
+	for(first = 1; ; first = 0)
+	{
+		if(!first)
+		{
+			if(':' != *s)
+			{
+				fail(cg, "expected ':' between components", s);
+			}
+			literal_char(cg, cg->params->subelement_separator, 0);
+			s++;
+		}
+		if('"' == *s)
+		{
+			for(s++; '"' != *s; s++)
+			{
+				if(!*s)
+				{
+					fail(cg, "unterminated literal", NULL);
+				}
+				if('\\' == *s && s[1])
+				{
+					s++;
+				}
+				literal_char(cg, (unsigned char) *s, 1);
+			}
+			s++;
+		}
+		else if(*s && ':' != *s)
+		{
+			n = ident(cg, s);
+			flush(cg);
+			if('#' == s[n])
+			{
+				outs(cg, "\tpos = edigen_long(buf, buflen, pos, (long) m->");
+				cg->uselong = 1;
+			}
+			else
+			{
+				outs(cg, "\tpos = edigen_str(buf, buflen, pos, m->");
+			}
+			cg->usestr = 1;
+			out(cg, s, n);
+			outs(cg, ");\n");
+			s += n;
+			if('#' == *s)
+			{
+				s++;
+			}
+		}
+		if(!*s)
+		{
+			break;
+		}
+	}
+}
+
+static void
+directive(codegen_t *cg, char *line, FILE *f)
+{
+	char *p, *arg;
+	size_t n;
+	
+	for(p = line; isspace((unsigned char) *p); p++);
+	n = strlen(p);
+	while(n && isspace((unsigned char) p[n - 1]))
+	{
+		p[--n] = 0;
+	}
+	if(!*p || '#' == *p)
+	{
+		return;
+	}
+	for(arg = p; *arg && !isspace((unsigned char) *arg); arg++);
+	if(*arg)
+	{
+		*arg = 0;
+		for(arg++; isspace((unsigned char) *arg); arg++);
+	}
+	if(!strcmp(p, "include"))
+	{
+		if(cg->bodylen)
+		{
+			fail(cg, "include must precede the first message", NULL);
+		}
+		fprintf(f, "#include %s\n", arg);
+	}
+	else if(!strcmp(p, "message"))
+	{
+		if(cg->inmessage)
+		{
+			fail(cg, "message without end", NULL);
+		}
+		n = ident(cg, arg);
+		for(p = arg + n; isspace((unsigned char) *p); p++);
+		if(!*p)
+		{
+			fail(cg, "expected a type name", NULL);
+		}
+		outs(cg, "\nsize_t\n");
+		out(cg, arg, n);
+		outs(cg, "(const ");
+		outs(cg, p);
+		outs(cg, " *m, char *buf, size_t buflen)\n{\n\tsize_t pos;\n\t\n\tpos = 0;\n");
+		cg->inmessage = 1;
+	}
+	else if(!strcmp(p, "segment"))
+	{
+		if(!cg->inmessage)
+		{
+			fail(cg, "segment outside of a message", NULL);
+		}
+		if(!*arg)
+		{
+			fail(cg, "expected a segment tag", NULL);
+		}
+		end_segment(cg);
+		for(; *arg; arg++)
+		{
+			literal_char(cg, (unsigned char) *arg, 1);
+		}
+		cg->insegment = 1;
+		cg->nelements = 0;
+	}
+	else if(!strcmp(p, "element"))
+	{
+		element(cg, arg);
+	}
+	else if(!strcmp(p, "end"))
+	{
+		if(!cg->inmessage)
+		{
+			fail(cg, "end outside of a message", NULL);
+		}
+		end_segment(cg);
+		flush(cg);
+		outs(cg, "\tif(pos < buflen)\n\t{\n\t\tbuf[pos] = 0;\n\t}\n\treturn pos;\n}\n");
+		cg->inmessage = 0;
+	}
+	else
+	{
+		fail(cg, "unknown directive", p);
+	}
+}
+
+/* Write the runtime helpers used by the generated functions */
+static void
+helpers(codegen_t *cg, FILE *f)
+{
+	char buf[32];
+	
+	fputs("\n#include <stdio.h>\n#include <string.h>\n\n", f);
+	fputs("static size_t\nedigen_raw(char *buf, size_t buflen, size_t pos, const char *s, size_t len)\n{\n"
+		"\tif(pos < buflen)\n\t{\n\t\tmemcpy(buf + pos, s, (len < buflen - pos ? len : buflen - pos));\n\t}\n"
+		"\treturn pos + len;\n}\n", f);
+	if(!cg->usestr)
+	{
+		return;
+	}
+	fputs("\nstatic size_t\nedigen_str(char *buf, size_t buflen, size_t pos, const char *s)\n{\n", f);
+	if(cg->params->escape)
+	{
+		fputs("\tsize_t n;\n\t\n\tif(NULL == s)\n\t{\n\t\treturn pos;\n\t}\n\tfor(;;)\n\t{\n"
+			"\t\tn = strcspn(s, \"", f);
+		fputs(cstring(buf, cg->specials, cg->nspecials), f);
+		fputs("\");\n\t\tpos = edigen_raw(buf, buflen, pos, s, n);\n\t\tif(!s[n])\n\t\t{\n\t\t\treturn pos;\n\t\t}\n"
+			"\t\tpos = edigen_raw(buf, buflen, pos, \"", f);
+		fputs(cstring(buf, &(cg->params->escape), 1), f);
+		fputs("\", 1);\n\t\tpos = edigen_raw(buf, buflen, pos, s + n, 1);\n\t\ts += n + 1;\n\t}\n}\n", f);
+	}
+	else
+	{
+		fputs("\treturn (NULL == s ? pos : edigen_raw(buf, buflen, pos, s, strlen(s)));\n}\n", f);
+	}
+	if(cg->uselong)
+	{
+		fputs("\nstatic size_t\nedigen_long(char *buf, size_t buflen, size_t pos, long value)\n{\n"
+			"\tchar tmp[32];\n\t\n\tsprintf(tmp, \"%ld\", value);\n\treturn edigen_str(buf, buflen, pos, tmp);\n}\n", f);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	codegen_t cg;
+	const char *pname, *outname;
+	unsigned char ch;
+	char line[LINE_MAX_LEN];
+	FILE *in, *f, *hdr;
+	int c, n;
+	
+	memset(&cg, 0, sizeof(cg));
+	pname = "UN/EDIFACT";
+	outname = NULL;
+	cg.specname = "<stdin>";
+	for(c = 1; c < argc && '-' == argv[c][0] && argv[c][1]; c++)
+	{
+		if(!strcmp(argv[c], "-p") && c + 1 < argc)
+		{
+			pname = argv[++c];
+		}
+		else if(!strcmp(argv[c], "-o") && c + 1 < argc)
+		{
+			outname = argv[++c];
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [-p PARAMS] [-o OUTPUT] [SPEC]\n", progname);
+			return EXIT_FAILURE;
+		}
+	}
+	if(c + 1 < argc)
+	{
+		fprintf(stderr, "Usage: %s [-p PARAMS] [-o OUTPUT] [SPEC]\n", progname);
+		return EXIT_FAILURE;
+	}
+	if(NULL == (cg.params = edi_detect_get_params(pname)))
+	{
+		fail(&cg, "no such parameters", pname);
+	}
+	/* The octets which must be escaped in values, as by the emitter */
+	for(n = 0; n < 5; n++)
+	{
+		switch(n)
+		{
+			case 0: ch = cg.params->segment_separator; break;
+			case 1: ch = cg.params->element_separator; break;
+			case 2: ch = cg.params->subelement_separator; break;
+			case 3: ch = cg.params->tag_separator; break;
+			default: ch = cg.params->escape; break;
+		}
+		if(ch && NULL == memchr(cg.specials, ch, cg.nspecials))
+		{
+			cg.specials[cg.nspecials++] = ch;
+		}
+	}
+	in = stdin;
+	if(c < argc && NULL == (in = fopen(argv[c], "r")))
+	{
+		fail(&cg, "cannot open specification", argv[c]);
+	}
+	if(c < argc)
+	{
+		cg.specname = argv[c];
+	}
+	/* Includes are written to a temporary file and placed after the
+	 * banner, ahead of the helpers and the generated functions.
+	 */
+	if(NULL == (hdr = tmpfile()))
+	{
+		fail(&cg, "cannot create temporary file", NULL);
+	}
+	while(NULL != fgets(line, sizeof(line), in))
+	{
+		cg.lineno++;
+		directive(&cg, line, hdr);
+	}
+	if(cg.inmessage)
+	{
+		fail(&cg, "message without end", NULL);
+	}
+	cg.lineno = 0;
+	if(in != stdin)
+	{
+		fclose(in);
+	}
+	f = stdout;
+	if(NULL != outname && NULL == (f = fopen(outname, "w")))
+	{
+		fail(&cg, "cannot create output file", outname);
+	}
+	fprintf(f, "/* Generated by %s from %s using %s parameters; do not edit. */\n\n", progname, cg.specname, pname);
+	fputs("#include <stddef.h>\n", f);
+	rewind(hdr);
+	while(EOF != (c = fgetc(hdr)))
+	{
+		fputc(c, f);
+	}
+	fclose(hdr);
+	helpers(&cg, f);
+	fwrite(cg.body, 1, cg.bodylen, f);
+	if(ferror(f) || (f != stdout && fclose(f)))
+	{
+		if(NULL != outname)
+		{
+			remove(outname);
+		}
+		fail(&cg, "error writing output", outname);
+	}
+	free(cg.body);
+	return EXIT_SUCCESS;
+}
@@ -30,9 +30,14 @@
 #ifndef LIBEDI_H_
 # define LIBEDI_H_                     1
 
+# include <stdio.h>
 # include <sys/types.h>
+# if !defined(_WIN32)
+#  include <sys/uio.h>
+#  define EDI_HAVE_IOV                 1
+# endif
 
-# define EDI_VERSION                   0x0103
+# define EDI_VERSION                   0x0107
 
 # define EDI_ELEMENT_SIMPLE            'S'
 # define EDI_ELEMENT_COMPOSITE         'C'
@@ -41,6 +46,27 @@
 # define EDI_ERR_SYSTEM                1      /* See errno for further information */
 # define EDI_ERR_UNTERMINATED          2      /* Parsing ended before the segment was terminated */
 # define EDI_ERR_EMPTY                 3      /* Parsing ended because the message was empty */
+# define EDI_ERR_BINARY                4      /* A binary segment's length or payload was malformed */
+# define EDI_ERR_SEGMENTS              5      /* The interchange has more than max_segments segments */
+# define EDI_ERR_ELEMENTS              6      /* A segment has more than max_elements elements */
+# define EDI_ERR_COMPONENTS            7      /* An element has more than max_components components */
+# define EDI_ERR_VALUELEN              8      /* A value is longer than max_value_length octets */
+# define EDI_ERR_MEMORY                9      /* The interchange would exceed max_memory octets */
+# define EDI_ERR_STOPPED               10     /* A reader callback asked for parsing to stop */
+
+/* Packed segment tag codes (see edi_segment_t), usable as case labels:
+ * EDI_TAG3('N', 'A', 'D') is the code of the tag "NAD".
+ */
+# define EDI_TAG4(a, b, c, d)          ((((unsigned long) (unsigned char) (a)) << 24) | \
+                                        (((unsigned long) (unsigned char) (b)) << 16) | \
+                                        (((unsigned long) (unsigned char) (c)) << 8) | \
+                                        ((unsigned long) (unsigned char) (d)))
+# define EDI_TAG3(a, b, c)             EDI_TAG4(a, b, c, 0)
+# define EDI_TAG2(a, b)                EDI_TAG4(a, b, 0, 0)
+# define EDI_TAG_NONE                  0UL    /* The tag is absent or longer than four octets */
+
+/* Size of a buffer large enough for any reader checkpoint */
+# define EDI_CHECKPOINT_MAX            192
 
 typedef struct edi_parser_struct edi_parser_t;
 typedef struct edi_detector_struct edi_detector_t;
@@ -50,6 +76,24 @@ typedef struct edi_interchange_struct edi_interchange_t;
 typedef struct edi_segment_struct edi_segment_t;
 typedef union edi_element_struct edi_element_t;
 typedef struct edi_interchange_private_struct edi_interchange_private_t;
+typedef struct edi_reader_struct edi_reader_t;
+typedef struct edi_writer_struct edi_writer_t;
+typedef struct edi_builder_struct edi_builder_t;
+typedef struct edi_iov_struct edi_iov_t;
+typedef struct edi_transcoder_struct edi_transcoder_t;
+typedef struct edi_group_struct edi_group_t;
+typedef struct edi_query_struct edi_query_t;
+typedef struct edi_result_struct edi_result_t;
+typedef struct edi_column_struct edi_column_t;
+typedef struct edi_columns_struct edi_columns_t;
+
+/* Called by a reader for each complete segment; return non-zero to stop */
+typedef int (*edi_reader_cb)(edi_reader_t *reader, const edi_segment_t *segment, void *data);
+
+/* Called by a builder to write @len octets of output; return 0 on success or
+ * -1 on failure.
+ */
+typedef int (*edi_builder_cb)(void *data, const char *buf, size_t len);
 
 /* Detector specifiers */
 struct edi_detector_struct
@@ -65,6 +109,11 @@ struct edi_detector_struct
 	size_t subelement_separator_pos;
 	size_t tag_separator_pos;
 	size_t escape_pos;
+	/* Index of the data element holding the interchange sender identifier
+	 * (counting the tag as element 0), used to look up partner profiles
+	 * registered with edi_partner_register(). Zero if not present.
+	 */
+	size_t sender_element;
 };
 
 /* Parser parameters structure. Always set version to EDI_VERSION to indicate
@@ -82,7 +131,11 @@ struct edi_params_struct
 	 * in XML output.
 	 */
 	const char *xml_root_node;
-	/* List of container segments, in the form START/END,START/END,... */
+	/* List of container segments, in the form START/END,START/END,...
+	 * where each may be followed by :N, indicating that data element N of
+	 * the start segment holds a control reference which is repeated in
+	 * the end segment.
+	 */
 	const char *containers;
 	/* Interchange header name (e.g., UNA, ISA) */
 	const char *ss_name;
@@ -95,6 +148,44 @@ struct edi_params_struct
 	  %R = release (escape)
 	*/
 	const char *ss_trailer;
+	/* Characters which may follow a segment separator and which are not
+	 * part of the next segment (e.g., "\r\n"). These are skipped when
+	 * parsing. NULL if none.
+	 */
+	const char *segment_whitespace;
+	/* String written following each segment separator when building an
+	 * interchange (e.g., "\r\n" to place each segment on its own line).
+	 * NULL if none.
+	 */
+	const char *segment_newline;
+	/* List of segments carrying length-prefixed binary data, in the form
+	 * TAG:N,TAG:N,... where data element N (counting the tag as element 0)
+	 * holds the length in octets of the binary payload, which forms data
+	 * element N+1. Payloads are not scanned for separators when parsing
+	 * or escaped when building. At most eight segments may be listed; a
+	 * list which is longer or malformed causes parser and builder
+	 * creation to fail, and edi_interchange_build() and its variants to
+	 * produce no output. NULL if none.
+	 */
+	const char *binary_segments;
+	/* Parsing limits; zero means unlimited. When a limit is reached,
+	 * parsing stops and the interchange parsed so far is returned along
+	 * with the corresponding EDI_ERR_xxx code. The tag counts towards
+	 * max_elements. max_memory bounds the octets of value storage and
+	 * segment and element tables held by the interchange. These apply
+	 * to the parser created with them, and are not taken from any
+	 * parameters found by auto-detection.
+	 */
+	size_t max_segments;
+	size_t max_elements;
+	size_t max_components;
+	size_t max_value_length;
+	size_t max_memory;
+	/* If non-zero, interchanges are indexed by segment tag and qualifier
+	 * as they are parsed, rather than when edi_interchange_find() is
+	 * first called. Like the limits, this is a property of the parser.
+	 */
+	int index_segments;
 };
 
 /* An EDI interchange (message), consisting of a number of segments */
@@ -114,6 +205,53 @@ struct edi_segment_struct
 	edi_element_t *elements;
 	size_t nelements;
 	char *tag;
+	/* The tag packed by EDI_TAG4(), or EDI_TAG_NONE. Set along with the
+	 * tag; after changing the tag directly, call edi_segment_touch().
+	 */
+	unsigned long tagcode;
+};
+
+/* A container within a parsed interchange (such as an interchange, functional
+ * group or message), delimited by start and end segments as specified by the
+ * containers parameter.
+ */
+struct edi_group_struct
+{
+	size_t kind; /* Index of the matching entry of the containers parameter */
+	size_t start; /* Index of the start segment */
+	size_t end; /* Index of the end segment, or (size_t) -1 if there is none */
+	const edi_group_t *parent; /* The enclosing container, or NULL */
+	const edi_group_t **children; /* Containers directly within this one */
+	size_t nchildren;
+};
+
+/* The value found by a query (see edi_query_compile()) */
+struct edi_result_struct
+{
+	const char *value; /* NULL if nothing matched */
+	size_t len;
+	size_t segment; /* Index of the segment the value was found in */
+};
+
+/* A column of values extracted by edi_columns_extract(), laid out as an
+ * Apache Arrow variable-length binary array: value n occupies the octets
+ * of data from offsets[n] up to offsets[n + 1], and bit n of validity
+ * (least significant bit first) is set unless the value is null. Offsets
+ * are size_t, matching Arrow's large binary layout where size_t is 64 bits.
+ */
+struct edi_column_struct
+{
+	size_t *offsets; /* One entry per row, plus one */
+	char *data;
+	unsigned char *validity;
+	size_t nnull; /* Number of null values */
+};
+
+struct edi_columns_struct
+{
+	size_t nrows;
+	size_t ncolumns;
+	edi_column_t *columns;
 };
 
 /* An EDI data element. This comes in one of two flavours - EDI_ELEMENT_SIMPLE,
@@ -177,21 +315,264 @@ union edi_element_struct
 PUBLISHED edi_parser_t *edi_parser_create(const edi_params_t *params);
 PUBLISHED int edi_parser_destroy(edi_parser_t *parser);
 PUBLISHED edi_interchange_t *edi_parser_parse(edi_parser_t *parser, const char *message);
+/* As edi_parser_parse(), but the message is @len bytes long and need not be
+ * NUL-terminated. Binary payloads in the resulting interchange refer directly
+ * to @message (and are not NUL-terminated), so it must remain valid for as
+ * long as they are used.
+ */
+PUBLISHED edi_interchange_t *edi_parser_parse_buf(edi_parser_t *parser, const char *message, size_t len);
+/* As edi_parser_parse_buf(), but the parser is not modified and the result
+ * (one of EDI_ERR_xxx) is stored in @error; a parser may be shared between
+ * any number of threads calling this function.
+ */
+PUBLISHED edi_interchange_t *edi_parser_parse_r(const edi_parser_t *parser, const char *message, size_t len, int *error);
+/* Return the result of the calling thread's most recent edi_parser_parse() or
+ * edi_parser_parse_buf() call, provided that it was made using @p.
+ */
 PUBLISHED int edi_parser_error(edi_parser_t *p);
 
+/* Streaming parser. Data is supplied in pieces of any size with
+ * edi_reader_feed(), and @cb is invoked for each segment as soon as it is
+ * complete; the segment (and any binary payload, which may refer to the data
+ * supplied) is only valid for the duration of the callback. Auto-detection is
+ * performed once the first 128 bytes of the stream are available.
+ *
+ * edi_reader_checkpoint() records the reader's position, the detected
+ * flavour and the containers currently open as a short NUL-terminated string
+ * which can be stored and passed to edi_reader_create() to resume parsing,
+ * with a parser created using the same parameters, from edi_reader_offset()
+ * bytes into the stream. @parser must remain valid until the reader is
+ * destroyed. Functions returning an error code return one of EDI_ERR_xxx;
+ * errors other than EDI_ERR_STOPPED are returned by all subsequent calls.
+ */
+PUBLISHED edi_reader_t *edi_reader_create(const edi_parser_t *parser, const char *checkpoint);
+PUBLISHED int edi_reader_destroy(edi_reader_t *reader);
+PUBLISHED int edi_reader_feed(edi_reader_t *reader, const char *buf, size_t len, edi_reader_cb cb, void *data);
+/* Signal the end of the stream, delivering any remaining segments */
+PUBLISHED int edi_reader_finish(edi_reader_t *reader, edi_reader_cb cb, void *data);
+/* Return the offset within the stream of the first byte not yet consumed */
+PUBLISHED off_t edi_reader_offset(const edi_reader_t *reader);
+/* Return the number of containers (e.g., UNB, UNH) open following the most
+ * recent segment, and the start tag of the container at @level (0 being the
+ * outermost).
+ */
+PUBLISHED size_t edi_reader_depth(const edi_reader_t *reader);
+PUBLISHED const char *edi_reader_container(const edi_reader_t *reader, size_t level);
+/* Store a checkpoint in @buf and return its length, not including the NUL
+ * terminator; if this is not less than @buflen, nothing is stored.
+ */
+PUBLISHED size_t edi_reader_checkpoint(const edi_reader_t *reader, char *buf, size_t buflen);
+
 /* EDI message building */
 
 PUBLISHED edi_interchange_t *edi_interchange_create(void);
 PUBLISHED int edi_interchange_destroy(edi_interchange_t *interchange);
+/* Serialize @msg into @buf, returning the number of octets stored. If there
+ * is room, a NUL terminator is added (but not counted). Zero is returned if
+ * @params can't be used to build (see binary_segments).
+ */
 PUBLISHED size_t edi_interchange_build(edi_interchange_t *msg, const edi_params_t *params, char *buf, size_t buflen);
+/* Return the exact number of octets edi_interchange_build() would produce
+ * for @msg given unlimited space, not including the NUL terminator.
+ */
+PUBLISHED size_t edi_interchange_build_size(edi_interchange_t *msg, const edi_params_t *params);
+/* As edi_interchange_build(), but divide the work between @nthreads threads
+ * (or one per processor if @nthreads is zero). The output is identical.
+ * Small interchanges, or builds where threads are unavailable, are
+ * performed on the calling thread.
+ */
+PUBLISHED size_t edi_interchange_build_parallel(edi_interchange_t *msg, const edi_params_t *params, char *buf, size_t buflen, unsigned int nthreads);
+# ifdef EDI_HAVE_IOV
+/* Serialize @msg as a vector suitable for writev(), whose entries refer
+ * directly to values which need no escaping (and so are only valid until
+ * @msg is modified or destroyed), and otherwise to storage which belongs to
+ * the result. edi_iov_vector() returns the vector and stores the number of
+ * entries in @count; the output is identical to that of
+ * edi_interchange_build(), without a NUL terminator.
+ */
+PUBLISHED edi_iov_t *edi_interchange_build_iov(edi_interchange_t *msg, const edi_params_t *params);
+PUBLISHED const struct iovec *edi_iov_vector(const edi_iov_t *iov, size_t *count);
+PUBLISHED int edi_iov_destroy(edi_iov_t *iov);
+# endif
+/* Serialize @msg in pieces: each call to edi_writer_fill() stores up to
+ * @buflen octets of output in @buf and returns the number stored, which is
+ * only less than @buflen once the output is complete (or an error has
+ * occurred). The output is identical to that of edi_interchange_build(),
+ * without a NUL terminator. Neither @msg nor @params may be modified or
+ * released until edi_writer_done(), which returns 0 if all of the output
+ * was produced and -1 otherwise.
+ */
+PUBLISHED edi_writer_t *edi_writer_begin(edi_interchange_t *msg, const edi_params_t *params);
+PUBLISHED size_t edi_writer_fill(edi_writer_t *writer, char *buf, size_t buflen);
+PUBLISHED int edi_writer_done(edi_writer_t *writer);
+
+/* Streaming builder. Each call to edi_builder_segment() begins a new segment,
+ * to which elements may be added with edi_element_create() and
+ * edi_element_add(); it is written out (through an internal buffer) when the
+ * next is begun, so is only valid until then. An end segment (e.g., UNT)
+ * with no data elements is completed with the count and control reference
+ * of its container, and edi_builder_close() writes the end segment of the
+ * innermost open container. edi_builder_finish() closes any containers
+ * still open and writes any buffered output; neither it nor the sink is
+ * used by edi_builder_destroy(). Functions returning int return 0 on
+ * success and -1 on failure, after which the builder can't be used further.
+ */
+PUBLISHED edi_builder_t *edi_builder_create(const edi_params_t *params, edi_builder_cb cb, void *data);
+PUBLISHED edi_builder_t *edi_builder_create_fd(const edi_params_t *params, int fd);
+PUBLISHED edi_builder_t *edi_builder_create_file(const edi_params_t *params, FILE *f);
+PUBLISHED int edi_builder_destroy(edi_builder_t *builder);
+PUBLISHED edi_segment_t *edi_builder_segment(edi_builder_t *builder, const char *tag);
+PUBLISHED int edi_builder_close(edi_builder_t *builder);
+PUBLISHED int edi_builder_finish(edi_builder_t *builder);
+/* Return the number of segments written so far */
+PUBLISHED size_t edi_builder_count(const edi_builder_t *builder);
+/* Batching. Whole messages may be added with edi_builder_message(), which
+ * refers to the values of @msg until the next call to the builder, or with
+ * edi_builder_message_raw(), given a message already serialized using the
+ * builder's parameters. Containers a message leaves open are closed after
+ * it. Once edi_builder_batch() has supplied an envelope, its segments (e.g.,
+ * UNB, or ISA and GS) are written before the first message of each batch,
+ * with the control references of any containers they begin replaced by a
+ * sequence number starting at @seq (padded to the width of the original if
+ * it was numeric). A batch is closed, with its end segments completed and
+ * its output passed to the sink, when it holds @maxmessages messages or at
+ * least @maxoctets octets, or when the builder is next called (or polled
+ * with edi_builder_poll()) once it has been open for @maxage seconds; zero
+ * means no limit. @envelope must remain valid while batching.
+ */
+PUBLISHED int edi_builder_batch(edi_builder_t *builder, const edi_interchange_t *envelope, unsigned long seq);
+PUBLISHED int edi_builder_batch_limits(edi_builder_t *builder, size_t maxmessages, size_t maxoctets, unsigned long maxage);
+PUBLISHED int edi_builder_message(edi_builder_t *builder, const edi_interchange_t *msg);
+PUBLISHED int edi_builder_message_raw(edi_builder_t *builder, const char *buf, size_t len);
+PUBLISHED int edi_builder_poll(edi_builder_t *builder);
 	
+/* Segments and elements are stored in arrays which grow geometrically, so
+ * adding one may move those already created. Reserving room in advance for
+ * @count segments (or elements) in total keeps pointers to existing ones
+ * valid until that many have been added. Return 0 on success, -1 on failure.
+ */
+PUBLISHED int edi_interchange_reserve(edi_interchange_t *interchange, size_t count);
+PUBLISHED int edi_segment_reserve(edi_segment_t *seg, size_t count);
+
+/* Once splicing is enabled for a parsed interchange, each segment which has
+ * not been modified since is built by copying it exactly as it appeared in
+ * the parsed message, which must therefore remain valid and unchanged.
+ * This applies only when building with the separators and escape character
+ * the interchange was parsed with. Adding or setting values marks a segment
+ * as modified; after changing the structures directly, call
+ * edi_segment_touch().
+ */
+PUBLISHED int edi_interchange_splice(edi_interchange_t *interchange, int enable);
+PUBLISHED int edi_segment_touch(edi_segment_t *seg);
+
+/* Find the segments of @interchange whose tag is @tag and, unless
+ * @qualifier is NULL, whose first data element (or its first component) is
+ * @qualifier. *@indices is set to the indices of the matching segments in
+ * ascending order, which remain valid until the interchange is next
+ * modified. Returns the number of matching segments, or (size_t) -1 on
+ * failure. The index used is built on first use and kept up to date as
+ * segments are added.
+ */
+PUBLISHED size_t edi_interchange_find(edi_interchange_t *interchange, const char *tag, const char *qualifier, const size_t **indices);
+/* As edi_interchange_find(), but return the first matching segment, or
+ * NULL if there is none.
+ */
+PUBLISHED edi_segment_t *edi_interchange_find_segment(edi_interchange_t *interchange, const char *tag, const char *qualifier);
+
+/* The parser records the containers of an interchange as it parses it.
+ * edi_interchange_ngroups() returns the number of containers of the given
+ * @kind (an index into the containers parameter; e.g., 2 for UNH/UNT in
+ * UN/EDIFACT), and edi_interchange_group() the @n'th of them in order, or
+ * NULL. edi_segment_group() returns the innermost container holding @seg,
+ * or NULL. These describe the interchange as parsed, and do not reflect
+ * segments added since.
+ */
+PUBLISHED size_t edi_interchange_ngroups(const edi_interchange_t *interchange, size_t kind);
+PUBLISHED const edi_group_t *edi_interchange_group(const edi_interchange_t *interchange, size_t kind, size_t n);
+PUBLISHED const edi_group_t *edi_segment_group(const edi_segment_t *seg);
+
+/* Compile @npaths path expressions for evaluation together. Each has the
+ * form TAG[PREDICATE]...[/ELEMENT[:COMPONENT]], where elements are counted
+ * with the tag as element 0 and components from 1; the value selected
+ * defaults to the first component of element 1. A predicate is one of
+ * [VALUE] or [qualifier=VALUE], requiring the first component of element
+ * 1 to be VALUE, or [ELEMENT=VALUE] or [ELEMENT:COMPONENT=VALUE]. For
+ * example, DTM[137]/1:2 selects the date of a DTM segment whose qualifier
+ * is 137. Returns NULL on failure, setting *@errpath (if not NULL) to the
+ * index of the path which could not be compiled (or to @npaths if the
+ * query itself could not be allocated).
+ */
+PUBLISHED edi_query_t *edi_query_compile(const char *const *paths, size_t npaths, size_t *errpath);
+PUBLISHED int edi_query_destroy(edi_query_t *query);
+/* Evaluate @query over the segments of @group within @interchange (or all
+ * of its segments if @group is NULL) in a single pass, setting @results[n]
+ * to the value selected by the first segment matching path @n. Returns the
+ * number of paths which matched. Results refer to the interchange's values.
+ */
+PUBLISHED size_t edi_query_run(const edi_query_t *query, const edi_interchange_t *interchange, const edi_group_t *group, edi_result_t *results);
+/* Evaluate @query against the single segment @seg, numbered @segno, filling
+ * those @results which are still empty (their value is NULL). This allows
+ * queries to be evaluated during parsing, from a reader callback; as the
+ * reader's segments are transient, the values must be copied there.
+ * Returns the number of results filled.
+ */
+PUBLISHED size_t edi_query_segment(const edi_query_t *query, const edi_segment_t *seg, size_t segno, edi_result_t *results);
+
+/* Extract a table of values from the segments of @group within
+ * @interchange (or all of its segments if @group is NULL). A row begins
+ * at each segment tagged @rowtag and extends up to the next, or to the end
+ * of the innermost container holding it. Column n holds the value selected
+ * within each row by the path @paths[n] (see edi_query_compile()), or null
+ * if there is none; e.g., with the row tag LIN, the paths LIN/3:1,
+ * QTY[21]/1:2 and PRI[AAA]/1:2 extract the item number, quantity and price
+ * of each line item. Values are copied, so the result remains valid after
+ * the interchange is destroyed. Returns NULL on failure.
+ */
+PUBLISHED edi_columns_t *edi_columns_extract(const edi_interchange_t *interchange, const edi_group_t *group, const char *rowtag, const char *const *paths, size_t npaths);
+PUBLISHED int edi_columns_destroy(edi_columns_t *columns);
+
 PUBLISHED edi_segment_t *edi_segment_create(edi_interchange_t *interchange, const char *tag);
+/* Return the packed code of @tag (see EDI_TAG4()), or EDI_TAG_NONE */
+PUBLISHED unsigned long edi_tag_code(const char *tag);
 
 PUBLISHED edi_element_t *edi_element_create(edi_segment_t *seg, const char *value);
 PUBLISHED int edi_element_add(edi_element_t *el, const char *value);
+/* Replace the value (or values) of @el with a copy of @value */
+PUBLISHED int edi_element_set(edi_element_t *el, const char *value);
+/* As edi_element_create() and edi_element_add(), but refer to @len octets at
+ * @value (which need not be NUL-terminated) rather than copying them. The
+ * caller must keep @value intact until the interchange has been built or
+ * destroyed. A segment's tag is always copied.
+ */
+PUBLISHED edi_element_t *edi_element_create_ref(edi_segment_t *seg, const char *value, size_t len);
+PUBLISHED int edi_element_add_ref(edi_element_t *el, const char *value, size_t len);
+
+/* Separator transcoding. Data supplied to edi_transcoder_feed() is parsed
+ * by @parser (including auto-detection, if enabled) and written to @cb as if
+ * it had been parsed and then built using @params, but segment by segment
+ * and without creating an interchange. The return values are as for
+ * edi_reader_feed() and edi_reader_finish(); failure of @cb is reported as
+ * EDI_ERR_SYSTEM. @parser must remain valid until the transcoder is
+ * destroyed.
+ */
+PUBLISHED edi_transcoder_t *edi_transcoder_create(const edi_parser_t *parser, const edi_params_t *params, edi_builder_cb cb, void *data);
+PUBLISHED int edi_transcoder_destroy(edi_transcoder_t *transcoder);
+PUBLISHED int edi_transcoder_feed(edi_transcoder_t *transcoder, const char *buf, size_t len);
+PUBLISHED int edi_transcoder_finish(edi_transcoder_t *transcoder);
 
 /* Detection */
 PUBLISHED edi_regparams_t *edi_params_register(const char *name, const edi_params_t *params);
+/* As edi_params_register(), but also supply a list of detectors, terminated
+ * by one whose detectstr is NULL, used to recognise interchanges which use
+ * the parameters. Where the detectors of several parameter sets match an
+ * interchange, the one with the longest detectstr is used.
+ */
+PUBLISHED edi_regparams_t *edi_params_register_detect(const char *name, const edi_params_t *params, const edi_detector_t *detectors);
+/* Use @params, which must have been registered, for any interchange whose
+ * header identifies its sender as @sender, in preference to the separators
+ * which would otherwise be detected.
+ */
+PUBLISHED int edi_partner_register(const char *sender, const edi_regparams_t *params);
 PUBLISHED const edi_regparams_t *edi_detect_get(const char *name);
 PUBLISHED const edi_params_t *edi_detect_get_params(const char *name);
 
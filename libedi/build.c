@@ -33,6 +33,8 @@
 
 #include "p_libedi.h"
 
+static int edi__emit_splice(const edi_emitter_t *em, const edi_interchange_t *msg);
+
 edi_interchange_t *
 edi_interchange_create(void)
 {
@@ -56,86 +58,239 @@ edi_interchange_create(void)
 	return p;
 }
 
+/* Resize the segment list of @msg to hold @n segments, updating the elements'
+ * references to their segments if it moves.
+ */
+int
+edi__interchange_grow(edi_interchange_t *msg, size_t n)
+{
+	edi_segment_t *segp;
+	edi_seginfo_t *ip;
+	size_t c, d;
+	
+	ip = (edi_seginfo_t *) realloc(msg->private_->info, sizeof(edi_seginfo_t) * n);
+	if(NULL == ip)
+	{
+		return -1;
+	}
+	msg->private_->info = ip;
+	segp = (edi_segment_t *) realloc(msg->segments, sizeof(edi_segment_t) * n);
+	if(NULL == segp)
+	{
+		return -1;
+	}
+	if(segp != msg->segments)
+	{
+		for(c = 0; c < msg->nsegments; c++)
+		{
+			for(d = 0; d < segp[c].nelements; d++)
+			{
+				segp[c].elements[d].simple.segment = &(segp[c]);
+			}
+		}
+	}
+	msg->segments = segp;
+	msg->private_->segalloc = n;
+	return 0;
+}
+
+/* Resize the element list of @seg to hold @n elements */
+int
+edi__segment_grow(edi_segment_t *seg, size_t n)
+{
+	edi_element_t *elp;
+	
+	elp = (edi_element_t *) realloc(seg->elements, sizeof(edi_element_t) * n);
+	if(NULL == elp)
+	{
+		return -1;
+	}
+	seg->elements = elp;
+	seg->interchange->private_->info[seg - seg->interchange->segments].elalloc = n;
+	return 0;
+}
+
+int
+edi_interchange_reserve(edi_interchange_t *msg, size_t count)
+{
+	if(count <= msg->private_->segalloc)
+	{
+		return 0;
+	}
+	return edi__interchange_grow(msg, count);
+}
+
+int
+edi_segment_reserve(edi_segment_t *seg, size_t count)
+{
+	if(count <= seg->interchange->private_->info[seg - seg->interchange->segments].elalloc)
+	{
+		return 0;
+	}
+	return edi__segment_grow(seg, count);
+}
+
+int
+edi_segment_touch(edi_segment_t *seg)
+{
+	edi_interchange_private_t *priv;
+	size_t c;
+	
+	priv = seg->interchange->private_;
+	c = seg - seg->interchange->segments;
+	priv->info[c].src = NULL;
+	seg->tagcode = edi_tag_code(seg->tag);
+	/* The segment's tag or qualifier may have changed */
+	if(c < priv->nindexed)
+	{
+		priv->indexstale = 1;
+	}
+	return 0;
+}
+
+int
+edi_interchange_splice(edi_interchange_t *msg, int enable)
+{
+	msg->private_->splice = enable;
+	return 0;
+}
+
 edi_segment_t *
 edi_segment_create(edi_interchange_t *i, const char *tag)
 {
 	edi_segment_t *segp;
 	
-	segp = (edi_segment_t *) realloc(i->segments, sizeof(edi_segment_t) * (i->nsegments + 1));
-	if(NULL == segp)
+	if(i->nsegments + 1 > i->private_->segalloc)
 	{
-		return NULL;
+		/* Grow geometrically, so that the cost of copying is linear
+		 * in the number of segments.
+		 */
+		if(-1 == edi__interchange_grow(i, i->private_->segalloc ? i->private_->segalloc * 2 : SEG_BLOCKSIZE))
+		{
+			return NULL;
+		}
 	}
-	i->segments = segp;
 	segp = &(i->segments[i->nsegments]);
 	memset(segp, 0, sizeof(edi_segment_t));
 	segp->interchange = i;
+	i->private_->info[i->nsegments].elalloc = 0;
+	i->private_->info[i->nsegments].src = NULL;
+	i->private_->info[i->nsegments].group = 0;
+	i->nsegments++;
 	if(tag)
 	{
 		if(NULL == edi_element_create(segp, tag))
 		{
+			i->nsegments--;
+			free(segp->elements);
 			return NULL;
 		}
 	}
-	i->nsegments++;
 	return segp;
 }
 
-edi_element_t *
-edi_element_create(edi_segment_t *seg, const char *value)
+unsigned long
+edi_tag_code(const char *tag)
 {
-	edi_element_t *elp;
+	size_t len;
 	
-	elp = (edi_element_t *) realloc(seg->elements, sizeof(edi_element_t) * (seg->nelements + 1));
-	if(NULL == elp)
+	if(NULL == tag)
 	{
-		return NULL;
+		return EDI_TAG_NONE;
 	}
-	seg->elements = elp;
-	elp = &(seg->elements[seg->nelements]);
-	memset(elp, 0, sizeof(elp));
-	elp->simple.segment = seg;
-	if(value)
+	/* Longer tags have no code, so there is no need to measure them */
+	for(len = 0; len < 5 && tag[len]; len++);
+	return edi__tag_code(tag, len);
+}
+
+/* Return the packed code of the @len-octet tag at @tag */
+unsigned long
+edi__tag_code(const char *tag, size_t len)
+{
+	unsigned long code;
+	size_t c;
+	
+	if(!len || len > 4)
+	{
+		return EDI_TAG_NONE;
+	}
+	for(code = 0, c = 0; c < 4; c++)
 	{
-		if(-1 == edi_element_add(elp, value))
+		code <<= 8;
+		if(c < len)
 		{
-			return NULL;
+			if(!tag[c])
+			{
+				return EDI_TAG_NONE;
+			}
+			code |= (unsigned char) tag[c];
 		}
-		if(elp == seg->elements)
+	}
+	return code;
+}
+
+/* Append a new, empty, element to @seg */
+static edi_element_t *
+edi__element_new(edi_segment_t *seg)
+{
+	edi_element_t *elp;
+	size_t n;
+	
+	n = seg->interchange->private_->info[seg - seg->interchange->segments].elalloc;
+	if(seg->nelements + 1 > n)
+	{
+		if(-1 == edi__segment_grow(seg, n ? n * 2 : ELEMENT_BLOCKSIZE))
 		{
-			seg->tag = elp->simple.value;
+			return NULL;
 		}
 	}
+	elp = &(seg->elements[seg->nelements]);
+	memset(elp, 0, sizeof(edi_element_t));
+	elp->simple.segment = seg;
 	seg->nelements++;
+	edi_segment_touch(seg);
 	return elp;
 }
 
-int
-edi_element_add(edi_element_t *elp, const char *value)
+/* Add a value of @vlen octets to @elp, either copying it into the
+ * interchange's stringpool or (where @copy is zero) referring to it where it
+ * is. A segment's tag is always copied, so that it is NUL-terminated.
+ */
+static int
+edi__element_add(edi_element_t *elp, const char *value, size_t vlen, int copy)
 {
 	char *v, **vp;
-	size_t vlen, vl, *lp;
+	size_t *lp;
 	
-	vlen = strlen(value);
-	if(!elp->type)
+	if(copy || (!elp->type && elp->simple.segment->elements == elp))
 	{
-		elp->simple.value = edi__stringpool_alloc(elp->simple.segment->interchange, vlen);
-		if(NULL == elp->simple.value)
+		v = edi__stringpool_alloc(elp->simple.segment->interchange, vlen + 1);
+		if(NULL == v)
 		{
 			return -1;
 		}
+		memcpy(v, value, vlen);
+		v[vlen] = 0;
+	}
+	else
+	{
+		v = (char *) value;
+	}
+	edi_segment_touch(elp->simple.segment);
+	if(!elp->type)
+	{
+		elp->simple.value = v;
 		elp->simple.valuelen = vlen;
 		elp->type = EDI_ELEMENT_SIMPLE;
 		if(elp->simple.segment->elements == elp)
 		{
 			elp->simple.segment->tag = elp->simple.value;
+			elp->simple.segment->tagcode = edi__tag_code(v, vlen);
 		}
 		return 0;
 	}
 	if(elp->type == EDI_ELEMENT_SIMPLE)
 	{
-		v = elp->simple.value;
-		vl = elp->simple.valuelen;
 		vp = (char **) malloc(sizeof(char *) * 2);
 		lp = (size_t *) malloc(sizeof(size_t) * 2);
 		if(!vp || !lp)
@@ -146,14 +301,8 @@ edi_element_add(edi_element_t *elp, const char *value)
 		}
 		vp[0] = elp->simple.value;
 		lp[0] = elp->simple.valuelen;
-		vp[1] = edi__stringpool_alloc(elp->simple.segment->interchange, vlen);
+		vp[1] = v;
 		lp[1] = vlen;
-		if(!vp[1])
-		{
-			free(vp);
-			free(lp);
-			return -1;
-		}
 		elp->composite.values = vp;
 		elp->composite.valuelens = lp;
 		elp->composite.nvalues = 2;
@@ -172,91 +321,317 @@ edi_element_add(edi_element_t *elp, const char *value)
 		return -1;
 	}
 	elp->composite.valuelens = lp;
-	v = edi__stringpool_alloc(elp->composite.segment->interchange, vlen);
-	if(!v)
-	{
-		return -1;
-	}
 	elp->composite.values[elp->composite.nvalues] = v;
 	elp->composite.valuelens[elp->composite.nvalues] = vlen;
 	elp->composite.nvalues++;
 	return 0;
 }
 
+edi_element_t *
+edi_element_create(edi_segment_t *seg, const char *value)
+{
+	edi_element_t *elp;
+	
+	if(NULL == (elp = edi__element_new(seg)))
+	{
+		return NULL;
+	}
+	if(value && -1 == edi__element_add(elp, value, strlen(value), 1))
+	{
+		seg->nelements--;
+		return NULL;
+	}
+	return elp;
+}
+
+edi_element_t *
+edi_element_create_ref(edi_segment_t *seg, const char *value, size_t len)
+{
+	edi_element_t *elp;
+	
+	if(NULL == (elp = edi__element_new(seg)))
+	{
+		return NULL;
+	}
+	if(value && -1 == edi__element_add(elp, value, len, 0))
+	{
+		seg->nelements--;
+		return NULL;
+	}
+	return elp;
+}
+
+int
+edi_element_set(edi_element_t *elp, const char *value)
+{
+	if(EDI_ELEMENT_COMPOSITE == elp->type)
+	{
+		free(elp->composite.values);
+		free(elp->composite.valuelens);
+	}
+	elp->type = 0;
+	return edi__element_add(elp, value, strlen(value), 1);
+}
+
+int
+edi_element_add(edi_element_t *elp, const char *value)
+{
+	return edi__element_add(elp, value, strlen(value), 1);
+}
+
+int
+edi_element_add_ref(edi_element_t *elp, const char *value, size_t len)
+{
+	return edi__element_add(elp, value, len, 0);
+}
+
 int
 edi_interchange_destroy(edi_interchange_t *msg)
 {
-	size_t c, d, i;
+	edi__interchange_reset(msg);
+	free(msg->segments);
+	free(msg->private_->info);
+	edi__stringpool_destroy(msg);
+	free(msg->private_);
+	free(msg);
+	return 0;
+}
 
+/* Remove all of an interchange's segments, retaining the segment list and
+ * stringpools for re-use.
+ */
+void
+edi__interchange_reset(edi_interchange_t *msg)
+{
+	size_t c, d;
+
+	/* Values are either held in the stringpools or refer to the source
+	 * message (binary payloads), so need not be freed individually.
+	 */
 	for(c = 0; c < msg->nsegments; c++)
 	{
 		for(d = 0; d < msg->segments[c].nelements; d++)
 		{
 			if(msg->segments[c].elements[d].type == EDI_ELEMENT_COMPOSITE)
 			{
-				for(i = 0; i < msg->segments[c].elements[d].composite.nvalues; i++)
-				{
-					edi__stringpool_free(msg, msg->segments[c].elements[d].composite.values[i]);
-				}
 				free(msg->segments[c].elements[d].composite.values);
 				free(msg->segments[c].elements[d].composite.valuelens);
 			}
-			else
-			{
-				edi__stringpool_free(msg, msg->segments[c].elements[d].simple.value);
-			}
 		}
 		free(msg->segments[c].elements);
 	}
-	free(msg->segments);
-	edi__stringpool_destroy(msg);
-	free(msg->private_);
-	free(msg);
-	return 0;
+	msg->nsegments = 0;
+	edi__index_destroy(msg);
+	edi__group_destroy(msg);
+	edi__stringpool_reset(msg);
 }
 
-static size_t
-addescaped(unsigned char *buf, size_t bufpos, size_t buflen, const char *value, size_t vlen, const edi_params_t *params)
+/* Prepare to serialize interchanges using @params, returning -1 if its
+ * binary segments can't be compiled (as edi_parser_create() would).
+ */
+int
+edi__emitter_init(edi_emitter_t *em, const edi_params_t *params)
 {
-	size_t n;
-	char *p;
+	int r;
+	
+	if(NULL == params)
+	{
+		params = &edi__default_params;
+	}
+	memset(em, 0, sizeof(edi_emitter_t));
+	em->params = params;
+	if(0x0104 <= params->version)
+	{
+		em->newline = params->segment_newline;
+	}
+	if(0x0105 <= params->version && NULL != params->binary_segments)
+	{
+		if(-1 == (r = edi__binary_compile(params->binary_segments, em->binary, BINARY_MAX)))
+		{
+			return -1;
+		}
+		em->nbinary = r;
+	}
+	if(0x0103 <= params->version)
+	{
+		if(NULL != params->ss_name && NULL != params->ss_trailer)
+		{
+			em->hdrname = params->ss_name;
+			em->hdrtrail = params->ss_trailer;
+		}
+	}
+	edi__escape_init(em);
+	return 0;
+}
 
-	(void) vlen;
+#ifdef EDI_HAVE_IOV
+/* Append @len octets at @p to @iov, either by reference or by copying them
+ * into its scratch area.
+ */
+static void
+edi__iov_add(edi_iov_t *iov, const char *p, size_t len, int ref)
+{
+	struct iovec *vp;
+	size_t n, *op;
+	char *sp;
 	
-	p = (char *) buf;
-	n = bufpos;
-	for(; *value && bufpos < buflen; value++)
-	{
-		if((*value == params->segment_separator ||
-			*value == params->element_separator ||
-			*value == params->subelement_separator ||
-			*value == params->tag_separator ||
-			*value == params->escape) &&
-			params->escape)
+	if(!len || iov->error)
+	{
+		return;
+	}
+	if(!ref)
+	{
+		if(iov->scratchlen + len > iov->scratchalloc)
 		{
-			*buf = params->escape;
-			buf++;
-			bufpos++;
-			if(bufpos >= buflen) break;
+			for(n = (iov->scratchalloc ? iov->scratchalloc * 2 : WRITER_BLOCKSIZE); n < iov->scratchlen + len; n *= 2)
+			{
+			}
+			if(NULL == (sp = (char *) realloc(iov->scratch, n)))
+			{
+				iov->error = 1;
+				return;
+			}
+			iov->scratch = sp;
+			iov->scratchalloc = n;
+		}
+		memcpy(iov->scratch + iov->scratchlen, p, len);
+		iov->scratchlen += len;
+		/* Extend the previous entry if it ends at the same point */
+		if(iov->nvec && (size_t) -1 != iov->scratchoff[iov->nvec - 1] &&
+			iov->scratchoff[iov->nvec - 1] + iov->vec[iov->nvec - 1].iov_len == iov->scratchlen - len)
+		{
+			iov->vec[iov->nvec - 1].iov_len += len;
+			return;
 		}
-		*buf = (unsigned char) *value;
-		buf++;
-		bufpos++;
-		if(bufpos >= buflen) break;
 	}
-	*buf = 0;
-	return bufpos - n;
+	if(iov->nvec + 1 > iov->vecalloc)
+	{
+		n = (iov->vecalloc ? iov->vecalloc * 2 : ELEMENT_BLOCKSIZE);
+		if(NULL == (vp = (struct iovec *) realloc(iov->vec, sizeof(struct iovec) * n)))
+		{
+			iov->error = 1;
+			return;
+		}
+		iov->vec = vp;
+		if(NULL == (op = (size_t *) realloc(iov->scratchoff, sizeof(size_t) * n)))
+		{
+			iov->error = 1;
+			return;
+		}
+		iov->scratchoff = op;
+		iov->vecalloc = n;
+	}
+	/* Scratch entries are pointed at the scratch area once it has
+	 * stopped moving.
+	 */
+	iov->vec[iov->nvec].iov_base = (void *) (ref ? p : NULL);
+	iov->vec[iov->nvec].iov_len = len;
+	iov->scratchoff[iov->nvec] = (ref ? (size_t) -1 : iov->scratchlen - len);
+	iov->nvec++;
+}
+
+/* Remove the last octet added to @iov */
+static void
+edi__iov_backspace(edi_iov_t *iov)
+{
+	if(!iov->nvec || iov->error)
+	{
+		return;
+	}
+	if((size_t) -1 != iov->scratchoff[iov->nvec - 1])
+	{
+		iov->scratchlen--;
+	}
+	if(0 == --iov->vec[iov->nvec - 1].iov_len)
+	{
+		iov->nvec--;
+	}
 }
+#endif
 
-static size_t
-addhdrtrailer(unsigned char *buf, size_t bufpos, size_t buflen, const char *format, edi_interchange_t *msg, const edi_params_t *params)
+/* Append @len octets to @sink; those which don't fit are counted, but not
+ * stored.
+ */
+static void
+addrawlen(edi_sink_t *sink, const char *value, size_t len)
 {
 	size_t n;
 	
-	(void) msg;
+#ifdef EDI_HAVE_IOV
+	if(NULL != sink->iov)
+	{
+		edi__iov_add(sink->iov, value, len, len >= IOV_MINREF);
+		sink->pos += len;
+		return;
+	}
+#endif
+	if(NULL != sink->buf && sink->pos < sink->buflen)
+	{
+		n = (len < sink->buflen - sink->pos ? len : sink->buflen - sink->pos);
+		memcpy(sink->buf + sink->pos, value, n);
+	}
+	sink->pos += len;
+}
+
+static void
+addchar(edi_sink_t *sink, int ch)
+{
+#ifdef EDI_HAVE_IOV
+	char c;
 	
-	n = bufpos;
-	for(; *format && bufpos < buflen; format++)
+	if(NULL != sink->iov)
+	{
+		c = (char) ch;
+		edi__iov_add(sink->iov, &c, 1, 0);
+		sink->pos++;
+		return;
+	}
+#endif
+	if(NULL != sink->buf && sink->pos < sink->buflen)
+	{
+		sink->buf[sink->pos] = (unsigned char) ch;
+	}
+	sink->pos++;
+}
+
+static void
+addraw(edi_sink_t *sink, const char *str)
+{
+	addrawlen(sink, str, strlen(str));
+}
+
+/* Append @value, escaping any special octets; the runs between them are
+ * copied whole.
+ */
+static void
+addescaped(edi_sink_t *sink, const char *value, size_t vlen, const edi_emitter_t *em)
+{
+	size_t n;
+	
+	if(!em->escape)
+	{
+		addrawlen(sink, value, vlen);
+		return;
+	}
+	while(vlen)
+	{
+		n = edi__escape_scan(em, value, vlen);
+		addrawlen(sink, value, n);
+		if(n == vlen)
+		{
+			break;
+		}
+		addchar(sink, em->escape);
+		addchar(sink, value[n]);
+		value += n + 1;
+		vlen -= n + 1;
+	}
+}
+
+static void
+addhdrtrailer(edi_sink_t *sink, const char *format, const edi_emitter_t *em)
+{
+	for(; *format; format++)
 	{
 		if('%' == *format)
 		{
@@ -264,180 +639,314 @@ addhdrtrailer(unsigned char *buf, size_t bufpos, size_t buflen, const char *form
 			switch(*format)
 			{
 				case '_':
-					if(bufpos > 0)
+					if(sink->pos > 0)
 					{
-						buf--;
-						bufpos--;
+						sink->pos--;
+#ifdef EDI_HAVE_IOV
+						if(NULL != sink->iov)
+						{
+							edi__iov_backspace(sink->iov);
+						}
+#endif
 					}
-					continue;
+					break;
 				case 'S':
-					*buf = params->segment_separator;
+					addchar(sink, em->sep_seg);
 					break;
 				case 'E':
-					*buf = params->element_separator;
+					addchar(sink, em->sep_data);
 					break;
 				case 's':
-					*buf = params->subelement_separator;
+					addchar(sink, em->sep_sub);
 					break;
 				case 'T':
-					*buf = params->tag_separator;
+					addchar(sink, em->sep_tag);
 					break;
 				case 'R':
-					*buf = params->escape;
+					addchar(sink, em->escape);
 					break;
+				case 0:
+					addchar(sink, '%');
+					return;
 				default:
-					*buf = '%';
-					buf++;
-					bufpos++;
-					if(bufpos >= buflen)
-					{
-						*buf = 0;
-						return bufpos - n;
-					}
-					*buf = *format;
+					addchar(sink, '%');
+					addchar(sink, *format);
 			}
-			buf++;
-			bufpos++;
 		}
 		else
 		{
-			*buf = *format;
-			buf++;
-			bufpos++;
+			addchar(sink, *format);
 		}
 	}
-	*buf = 0;
-	return bufpos - n;
 }
 
-size_t
-edi_interchange_build(edi_interchange_t *msg, const edi_params_t *params, char *buf, size_t buflen)
+/* Serialize @seg, which is the first of its interchange if @first is set, to
+ * @sink.
+ */
+void
+edi__emit_segment(const edi_emitter_t *em, edi_sink_t *sink, const edi_segment_t *seg, int first)
 {
-	size_t c, d, i, n, bufpos;
-	unsigned char *bp;
-	const char *hdrname, *hdrtrail;
+	size_t d, i, binel;
+	const edi_element_t *el;
+	const edi_seginfo_t *info;
 	int dohdrtrailer;
 	
-	if(NULL == params)
+	dohdrtrailer = 0;
+	/* Binary payloads are always element N+1 of their segments,
+	 * so binel is never zero when one is present.
+	 */
+	binel = 0;
+	if(NULL != seg->tag)
 	{
-		params = &edi__default_params;
+		for(i = 0; i < em->nbinary; i++)
+		{
+			if(0 == strcmp(seg->tag, em->binary[i].tag))
+			{
+				binel = em->binary[i].element + 1;
+				break;
+			}
+		}
 	}
-	bp = (unsigned char *) buf;
-	bufpos = 0;
-	hdrname = NULL;
-	hdrtrail = NULL;
-	dohdrtrailer = 0;
-	if(0x0103 <= params->version)
+	info = &(seg->interchange->private_->info[seg - seg->interchange->segments]);
+	if(NULL != info->src && edi__emit_splice(em, seg->interchange))
 	{
-		if(NULL != params->ss_name && NULL != params->ss_trailer)
+		/* Copy the segment as it was parsed */
+		if(first && NULL != em->hdrname && seg->nelements && (NULL == seg->tag || 0 != strcmp(seg->tag, em->hdrname)))
+		{
+			edi__emit_header(em, sink);
+		}
+		addrawlen(sink, info->src, info->srclen);
+		if(NULL != em->newline)
 		{
-			hdrname = params->ss_name;
-			hdrtrail = params->ss_trailer;
+			addraw(sink, em->newline);
 		}
+		return;
 	}
-	for(c = 0; c < msg->nsegments; c++)
+	if(first && NULL != em->hdrname && seg->nelements)
 	{
-		for(d = 0; d < msg->segments[c].nelements; d++)
+		/* If the interchange begins with the header segment (e.g.,
+		 * ISA), the service string advice replaces its segment
+		 * separator; otherwise it forms a standalone header (e.g.,
+		 * UNA). The tag is always a NUL-terminated copy, unlike
+		 * element values.
+		 */
+		if(NULL != seg->tag && 0 == strcmp(seg->tag, em->hdrname))
 		{
-			if(msg->segments[c].elements[d].type == EDI_ELEMENT_SIMPLE)
-			{
-				if(NULL != hdrname)
-				{
-					if(0 == c && 0 == d)
-					{
-						if(strlen(hdrname) == msg->segments[c].elements[d].simple.valuelen &&
-							0 == strncmp(hdrname, msg->segments[c].elements[d].simple.value, msg->segments[c].elements[d].simple.valuelen))
-						{
-							dohdrtrailer = 1;
-						}
-						else
-						{
-							n = addescaped(bp, bufpos, buflen, hdrname, strlen(hdrname), params);
-							bp += n;
-							bufpos += n;
-							if(bufpos >= buflen) break;
-							n = addhdrtrailer(bp, bufpos, buflen, hdrtrail, msg, params);
-							bp += n;
-							bufpos += n;
-							if(bufpos >= buflen) break;
-						}
-					}
-				}
-				n = addescaped(bp, bufpos, buflen, msg->segments[c].elements[d].simple.value, msg->segments[c].elements[d].simple.valuelen, params);
-				bp += n;
-				bufpos += n;
-			}
-			else
-			{
-				for(i = 0; i < msg->segments[c].elements[d].composite.nvalues; i++)
-				{
-					if(NULL != hdrname)
-					{
-						if(0 == c && 0 == d && 0 == i)
-						{
-							if(strlen(hdrname) == msg->segments[c].elements[d].simple.valuelen &&
-								0 == strncmp(hdrname, msg->segments[c].elements[d].simple.value, msg->segments[c].elements[d].simple.valuelen))
-							{
-								dohdrtrailer = 1;
-							}
-							else
-							{
-								n = addescaped(bp, bufpos, buflen, hdrname, strlen(hdrname), params);
-								bp += n;
-								bufpos += n;
-								if(bufpos >= buflen) break;
-								n = addhdrtrailer(bp, bufpos, buflen, hdrtrail, msg, params);
-								bp += n;
-								bufpos += n;
-								if(bufpos >= buflen) break;
-							}
-						}
-					}
-					n = addescaped(bp, bufpos, buflen, msg->segments[c].elements[d].composite.values[i], msg->segments[c].elements[d].composite.valuelens[i], params);
-					bp += n;
-					bufpos += n;
-					if(bufpos >= buflen) break;
-					if(i + 1 < msg->segments[c].elements[d].composite.nvalues)
-					{
-						*bp = params->subelement_separator;
-						bp++;
-						bufpos++;
-					}
-					if(bufpos >= buflen) break;
-				}
-			}
-			if(bufpos >= buflen) break;
-			if(d + 1 < msg->segments[c].nelements)
+			dohdrtrailer = 1;
+		}
+		else
+		{
+			edi__emit_header(em, sink);
+		}
+	}
+	for(d = 0; d < seg->nelements; d++)
+	{
+		el = &(seg->elements[d]);
+		if(d)
+		{
+			addchar(sink, (1 == d ? em->sep_tag : em->sep_data));
+		}
+		if(0 != binel && d == binel && el->type == EDI_ELEMENT_SIMPLE)
+		{
+			addrawlen(sink, el->simple.value, el->simple.valuelen);
+		}
+		else if(el->type == EDI_ELEMENT_SIMPLE)
+		{
+			addescaped(sink, el->simple.value, el->simple.valuelen, em);
+		}
+		else
+		{
+			for(i = 0; i < el->composite.nvalues; i++)
 			{
-				if(d == 0)
-				{
-					*bp = params->tag_separator;
-				}
-				else
+				if(i)
 				{
-					*bp = params->element_separator;
+					addchar(sink, em->sep_sub);
 				}
-				bp++;
-				bufpos++;
+				addescaped(sink, el->composite.values[i], el->composite.valuelens[i], em);
 			}
-			if(bufpos >= buflen) break;
 		}
-		if(bufpos >= buflen) break;
-		if(1 == dohdrtrailer)
+	}
+	edi__emit_end(em, sink, dohdrtrailer);
+}
+
+/* Return non-zero if the unmodified segments of @msg can be copied from
+ * their source, which requires that they were parsed with the same
+ * separators and escape character as will be used to build them.
+ */
+static int
+edi__emit_splice(const edi_emitter_t *em, const edi_interchange_t *msg)
+{
+	const unsigned char *sep;
+	
+	sep = msg->private_->srcsep;
+	return (msg->private_->splice && sep[0] == em->sep_seg && sep[1] == em->sep_data &&
+		sep[2] == em->sep_sub && sep[3] == em->sep_tag && sep[4] == em->escape);
+}
+
+/* Write a standalone service string advice header (e.g., UNA) */
+void
+edi__emit_header(const edi_emitter_t *em, edi_sink_t *sink)
+{
+	addescaped(sink, em->hdrname, strlen(em->hdrname), em);
+	addhdrtrailer(sink, em->hdrtrail, em);
+	if(NULL != em->newline)
+	{
+		addraw(sink, em->newline);
+	}
+}
+
+/* Terminate a segment; if @hdrtrailer is set, the segment is the header
+ * (e.g., ISA) and the service string advice takes the place of the
+ * segment separator.
+ */
+void
+edi__emit_end(const edi_emitter_t *em, edi_sink_t *sink, int hdrtrailer)
+{
+	if(hdrtrailer)
+	{
+		addhdrtrailer(sink, em->hdrtrail, em);
+	}
+	else
+	{
+		addchar(sink, em->sep_seg);
+	}
+	if(NULL != em->newline)
+	{
+		addraw(sink, em->newline);
+	}
+}
+
+/* Write @len octets of @value, escaped unless @raw is set */
+void
+edi__emit_value(const edi_emitter_t *em, edi_sink_t *sink, const char *value, size_t len, int raw)
+{
+	if(raw)
+	{
+		addrawlen(sink, value, len);
+	}
+	else
+	{
+		addescaped(sink, value, len, em);
+	}
+}
+
+void
+edi__emit_char(edi_sink_t *sink, int ch)
+{
+	addchar(sink, ch);
+}
+
+size_t
+edi_interchange_build(edi_interchange_t *msg, const edi_params_t *params, char *buf, size_t buflen)
+{
+	edi_emitter_t em;
+	edi_sink_t sink;
+	size_t c;
+	
+	if(-1 == edi__emitter_init(&em, params))
+	{
+		if(buflen)
 		{
-			n = addhdrtrailer(bp, bufpos, buflen, hdrtrail, msg, params);
-			bp += n;
-			bufpos += n;
+			buf[0] = 0;
 		}
-		else
+		return 0;
+	}
+	sink.buf = (unsigned char *) buf;
+	sink.buflen = buflen;
+	sink.pos = 0;
+	sink.iov = NULL;
+	/* Stop once the buffer is full; a backspace can never remove more
+	 * than one octet, so going one beyond it is sufficient.
+	 */
+	for(c = 0; c < msg->nsegments && sink.pos <= buflen; c++)
+	{
+		edi__emit_segment(&em, &sink, &(msg->segments[c]), 0 == c);
+	}
+	if(sink.pos < buflen)
+	{
+		buf[sink.pos] = 0;
+		return sink.pos;
+	}
+	return buflen;
+}
+
+size_t
+edi_interchange_build_size(edi_interchange_t *msg, const edi_params_t *params)
+{
+	edi_emitter_t em;
+	edi_sink_t sink;
+	size_t c;
+	
+	if(-1 == edi__emitter_init(&em, params))
+	{
+		return 0;
+	}
+	sink.buf = NULL;
+	sink.buflen = 0;
+	sink.pos = 0;
+	sink.iov = NULL;
+	for(c = 0; c < msg->nsegments; c++)
+	{
+		edi__emit_segment(&em, &sink, &(msg->segments[c]), 0 == c);
+	}
+	return sink.pos;
+}
+
+#ifdef EDI_HAVE_IOV
+edi_iov_t *
+edi_interchange_build_iov(edi_interchange_t *msg, const edi_params_t *params)
+{
+	edi_emitter_t em;
+	edi_sink_t sink;
+	edi_iov_t *iov;
+	size_t c;
+	
+	if(NULL == (iov = (edi_iov_t *) calloc(1, sizeof(edi_iov_t))))
+	{
+		return NULL;
+	}
+	if(-1 == edi__emitter_init(&em, params))
+	{
+		free(iov);
+		return NULL;
+	}
+	sink.buf = NULL;
+	sink.buflen = 0;
+	sink.pos = 0;
+	sink.iov = iov;
+	for(c = 0; c < msg->nsegments && !iov->error; c++)
+	{
+		edi__emit_segment(&em, &sink, &(msg->segments[c]), 0 == c);
+	}
+	if(iov->error)
+	{
+		edi_iov_destroy(iov);
+		return NULL;
+	}
+	for(c = 0; c < iov->nvec; c++)
+	{
+		if((size_t) -1 != iov->scratchoff[c])
 		{
-			*bp = params->segment_separator;
-			bp++;
-			bufpos++;
+			iov->vec[c].iov_base = iov->scratch + iov->scratchoff[c];
 		}
-		if(bufpos >= buflen) break;
-		dohdrtrailer = 0;
 	}
-	*bp = 0;
-	return bufpos;
+	return iov;
+}
+
+const struct iovec *
+edi_iov_vector(const edi_iov_t *iov, size_t *count)
+{
+	*count = iov->nvec;
+	return iov->vec;
 }
+
+int
+edi_iov_destroy(edi_iov_t *iov)
+{
+	free(iov->vec);
+	free(iov->scratchoff);
+	free(iov->scratch);
+	free(iov);
+	return 0;
+}
+#endif
@@ -0,0 +1,725 @@
+/* @(#) $Id$ */
+
+/*
+ * Copyright (c) 2003, 2004, 2005, 2006, 2007, 2008 Mo McRoberts.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) of this software may not be used to endorse
+ *    or promote products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY 
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * AUTHORS OF THIS SOFTWARE BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF 
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS 
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "p_libedi.h"
+
+#include <errno.h>
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+
+/* Build an interchange one segment at a time, writing each to a sink as soon
+ * as the next is begun. Containers described by params->containers are
+ * tracked so that their end segments can be completed automatically: the
+ * first data element of an end segment is the number of segments within
+ * the container (including the start and end segments) if it is the last
+ * (innermost) container listed, or otherwise the number of containers
+ * directly within it; the second is the control reference taken from the
+ * start segment, if one was specified.
+ */
+
+static int edi__builder_commit(edi_builder_t *b, edi_segment_t *seg);
+static int edi__builder_emit(edi_builder_t *b, const edi_segment_t *seg);
+static int edi__builder_close(edi_builder_t *b);
+static int edi__builder_flush(edi_builder_t *b);
+static int edi__builder_copy(edi_builder_t *b, const edi_segment_t *src, size_t refel, const char *ref);
+static const char *edi__builder_refvalue(const edi_element_t *el, size_t *len);
+static int edi__builder_begin(edi_builder_t *b);
+static int edi__builder_end(edi_builder_t *b);
+static int edi__builder_pending(edi_builder_t *b);
+static int edi__builder_endbatch(edi_builder_t *b);
+static int edi__builder_write_file(void *data, const char *buf, size_t len);
+#ifdef HAVE_UNISTD_H
+static int edi__builder_write_fd(void *data, const char *buf, size_t len);
+#endif
+
+edi_builder_t *
+edi_builder_create(const edi_params_t *params, edi_builder_cb cb, void *data)
+{
+	edi_builder_t *b;
+	int n;
+	
+	if(NULL == params)
+	{
+		params = &edi__default_params;
+	}
+	if(NULL == (b = (edi_builder_t *) calloc(1, sizeof(edi_builder_t))))
+	{
+		return NULL;
+	}
+	if(-1 == edi__emitter_init(&(b->em), params))
+	{
+		free(b);
+		return NULL;
+	}
+	if(params->version >= 0x0102 && NULL != params->containers)
+	{
+		if(-1 == (n = edi__container_compile(params->containers, b->containers, CONTAINER_MAX)))
+		{
+			free(b);
+			return NULL;
+		}
+		b->ncontainers = n;
+	}
+	if(-1 == edi__parser_init(&(b->parser), params))
+	{
+		free(b);
+		return NULL;
+	}
+	b->cb = cb;
+	b->data = data;
+	if(NULL == (b->interchange = edi_interchange_create()) ||
+		NULL == (b->trailer = edi_interchange_create()) ||
+		NULL == (b->buf = (unsigned char *) malloc(BUILDER_BUFSIZE)))
+	{
+		edi_builder_destroy(b);
+		return NULL;
+	}
+	b->bufalloc = BUILDER_BUFSIZE;
+	/* Pre-serialized segments are copied unless they must be completed */
+	edi_interchange_splice(b->interchange, 1);
+	b->interchange->private_->srcsep[0] = (unsigned char) b->parser.sep_seg;
+	b->interchange->private_->srcsep[1] = (unsigned char) b->parser.sep_data;
+	b->interchange->private_->srcsep[2] = (unsigned char) b->parser.sep_sub;
+	b->interchange->private_->srcsep[3] = (unsigned char) b->parser.sep_tag;
+	b->interchange->private_->srcsep[4] = (unsigned char) b->parser.escape;
+	return b;
+}
+
+edi_builder_t *
+edi_builder_create_fd(const edi_params_t *params, int fd)
+{
+#ifdef HAVE_UNISTD_H
+	edi_builder_t *b;
+	
+	if(NULL != (b = edi_builder_create(params, edi__builder_write_fd, NULL)))
+	{
+		b->fd = fd;
+		b->data = &(b->fd);
+	}
+	return b;
+#else
+	(void) params;
+	(void) fd;
+	
+	return NULL;
+#endif
+}
+
+edi_builder_t *
+edi_builder_create_file(const edi_params_t *params, FILE *f)
+{
+	return edi_builder_create(params, edi__builder_write_file, f);
+}
+
+int
+edi_builder_destroy(edi_builder_t *b)
+{
+	while(b->depth)
+	{
+		b->depth--;
+		free(b->stack[b->depth].ref);
+	}
+	if(NULL != b->interchange)
+	{
+		edi_interchange_destroy(b->interchange);
+	}
+	if(NULL != b->trailer)
+	{
+		edi_interchange_destroy(b->trailer);
+	}
+	free(b->buf);
+	free(b);
+	return 0;
+}
+
+edi_segment_t *
+edi_builder_segment(edi_builder_t *b, const char *tag)
+{
+	if(b->error)
+	{
+		return NULL;
+	}
+	if(b->interchange->nsegments && -1 == edi__builder_commit(b, &(b->interchange->segments[0])))
+	{
+		return NULL;
+	}
+	edi__interchange_reset(b->interchange);
+	return edi_segment_create(b->interchange, tag);
+}
+
+int
+edi_builder_close(edi_builder_t *b)
+{
+	if(-1 == edi__builder_pending(b))
+	{
+		return -1;
+	}
+	if(!b->depth)
+	{
+		return 0;
+	}
+	return edi__builder_close(b);
+}
+
+int
+edi_builder_finish(edi_builder_t *b)
+{
+	if(-1 == edi_builder_close(b))
+	{
+		return -1;
+	}
+	while(b->depth)
+	{
+		if(-1 == edi__builder_close(b))
+		{
+			return -1;
+		}
+	}
+	b->inbatch = 0;
+	return edi__builder_flush(b);
+}
+
+size_t
+edi_builder_count(const edi_builder_t *b)
+{
+	return b->nsegments;
+}
+
+int
+edi_builder_batch(edi_builder_t *b, const edi_interchange_t *envelope, unsigned long seq)
+{
+	if(b->error || b->inbatch)
+	{
+		return -1;
+	}
+	b->envelope = envelope;
+	b->seq = seq;
+	return 0;
+}
+
+int
+edi_builder_batch_limits(edi_builder_t *b, size_t maxmessages, size_t maxoctets, unsigned long maxage)
+{
+	b->maxmessages = maxmessages;
+	b->maxoctets = maxoctets;
+	b->maxage = maxage;
+	return 0;
+}
+
+int
+edi_builder_message(edi_builder_t *b, const edi_interchange_t *msg)
+{
+	size_t c;
+	
+	if(-1 == edi__builder_begin(b))
+	{
+		return -1;
+	}
+	for(c = 0; c < msg->nsegments; c++)
+	{
+		if(-1 == edi__builder_copy(b, &(msg->segments[c]), 0, NULL))
+		{
+			return -1;
+		}
+	}
+	return edi__builder_end(b);
+}
+
+int
+edi_builder_message_raw(edi_builder_t *b, const char *buf, size_t len)
+{
+	edi_parsestate_t state;
+	const char *end;
+	
+	if(-1 == edi__builder_begin(b) || -1 == edi__builder_pending(b))
+	{
+		return -1;
+	}
+	end = buf + len;
+	while(1)
+	{
+		while(buf < end && b->parser.skip[(unsigned char) *buf])
+		{
+			buf++;
+		}
+		if(buf >= end)
+		{
+			break;
+		}
+		memset(&state, 0, sizeof(state));
+		if(EDI_ERR_NONE != edi__parse_segment(&(b->parser), b->interchange, &state, &buf, end))
+		{
+			b->error = 1;
+			return -1;
+		}
+		if(-1 == edi__builder_pending(b))
+		{
+			return -1;
+		}
+	}
+	return edi__builder_end(b);
+}
+
+int
+edi_builder_poll(edi_builder_t *b)
+{
+	if(b->error)
+	{
+		return -1;
+	}
+	if(b->inbatch && b->maxage && (unsigned long) (time(NULL) - b->opened) >= b->maxage)
+	{
+		return edi__builder_endbatch(b);
+	}
+	return 0;
+}
+
+/* Begin a new segment which is a copy of @src, referring to its values. If
+ * @refel is non-zero, a copy of @ref is used in place of that element.
+ */
+static int
+edi__builder_copy(edi_builder_t *b, const edi_segment_t *src, size_t refel, const char *ref)
+{
+	edi_segment_t *seg;
+	edi_element_t *el;
+	const edi_element_t *sel;
+	size_t d, i;
+	
+	if(NULL == (seg = edi_builder_segment(b, NULL)) ||
+		-1 == edi_segment_reserve(seg, src->nelements + 2))
+	{
+		b->error = 1;
+		return -1;
+	}
+	for(d = 0; d < src->nelements; d++)
+	{
+		sel = &(src->elements[d]);
+		if(0 != refel && d == refel)
+		{
+			el = edi_element_create(seg, ref);
+		}
+		else if(EDI_ELEMENT_SIMPLE == sel->type)
+		{
+			el = edi_element_create_ref(seg, sel->simple.value, sel->simple.valuelen);
+		}
+		else
+		{
+			el = edi_element_create_ref(seg, NULL, 0);
+			for(i = 0; NULL != el && i < sel->composite.nvalues; i++)
+			{
+				if(-1 == edi_element_add_ref(el, sel->composite.values[i], sel->composite.valuelens[i]))
+				{
+					el = NULL;
+				}
+			}
+		}
+		if(NULL == el)
+		{
+			b->error = 1;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* Return the first value of @el and store its length in @len, or return NULL
+ * if @el has no value. The value is not necessarily NUL-terminated.
+ */
+static const char *
+edi__builder_refvalue(const edi_element_t *el, size_t *len)
+{
+	if(EDI_ELEMENT_SIMPLE == el->type && NULL != el->simple.value)
+	{
+		*len = el->simple.valuelen;
+		return el->simple.value;
+	}
+	if(EDI_ELEMENT_COMPOSITE == el->type && el->composite.nvalues && NULL != el->composite.values[0])
+	{
+		*len = el->composite.valuelens[0];
+		return el->composite.values[0];
+	}
+	*len = 0;
+	return NULL;
+}
+
+/* Prepare to add a message, closing the current batch if it has been open
+ * too long and opening a new one if necessary.
+ */
+static int
+edi__builder_begin(edi_builder_t *b)
+{
+	const edi_segment_t *seg;
+	const char *v;
+	char ref[32];
+	size_t c, d, n, len;
+	
+	if(-1 == edi_builder_poll(b))
+	{
+		return -1;
+	}
+	if(NULL == b->envelope || b->inbatch)
+	{
+		return 0;
+	}
+	if(-1 == edi__builder_pending(b))
+	{
+		return -1;
+	}
+	b->segstart = b->nsegments;
+	for(c = 0; c < b->envelope->nsegments; c++)
+	{
+		seg = &(b->envelope->segments[c]);
+		/* Number the start segments of containers which carry control
+		 * references, keeping the width of any numeric reference given.
+		 */
+		n = 0;
+		for(d = 0; NULL != seg->tag && d < b->ncontainers; d++)
+		{
+			if(0 == strcmp(seg->tag, b->containers[d].start))
+			{
+				n = b->containers[d].ref;
+				break;
+			}
+		}
+		if(n && n < seg->nelements && NULL != (v = edi__builder_refvalue(&(seg->elements[n]), &len)))
+		{
+			for(d = 0; d < len && v[d] >= '0' && v[d] <= '9'; d++)
+			{
+			}
+			/* Neither the width nor the widest %lu (20 digits) may
+			 * overflow ref.
+			 */
+			if(d < len || d >= sizeof(ref))
+			{
+				d = 0;
+			}
+			sprintf(ref, "%0*lu", (int) d, b->seq);
+		}
+		else
+		{
+			n = 0;
+		}
+		if(-1 == edi__builder_copy(b, seg, n, ref))
+		{
+			return -1;
+		}
+	}
+	if(-1 == edi__builder_pending(b))
+	{
+		return -1;
+	}
+	b->envdepth = b->depth;
+	b->inbatch = 1;
+	b->nmessages = 0;
+	b->batchoctets = b->noctets;
+	b->opened = time(NULL);
+	b->seq++;
+	return 0;
+}
+
+/* Complete a message, closing any containers it left open, and close the
+ * batch if it has reached its limits.
+ */
+static int
+edi__builder_end(edi_builder_t *b)
+{
+	if(-1 == edi__builder_pending(b))
+	{
+		return -1;
+	}
+	while(b->depth > b->envdepth)
+	{
+		if(-1 == edi__builder_close(b))
+		{
+			return -1;
+		}
+	}
+	if(!b->inbatch)
+	{
+		return 0;
+	}
+	b->nmessages++;
+	if((b->maxmessages && b->nmessages >= b->maxmessages) ||
+		(b->maxoctets && b->noctets - b->batchoctets >= b->maxoctets))
+	{
+		return edi__builder_endbatch(b);
+	}
+	return 0;
+}
+
+/* Write out the segment being built, if any */
+static int
+edi__builder_pending(edi_builder_t *b)
+{
+	if(b->error)
+	{
+		return -1;
+	}
+	if(b->interchange->nsegments)
+	{
+		if(-1 == edi__builder_commit(b, &(b->interchange->segments[0])))
+		{
+			return -1;
+		}
+		edi__interchange_reset(b->interchange);
+	}
+	return 0;
+}
+
+/* Close every open container and pass the batch to the sink */
+static int
+edi__builder_endbatch(edi_builder_t *b)
+{
+	if(-1 == edi__builder_pending(b))
+	{
+		return -1;
+	}
+	while(b->depth)
+	{
+		if(-1 == edi__builder_close(b))
+		{
+			return -1;
+		}
+	}
+	b->inbatch = 0;
+	b->envdepth = 0;
+	return edi__builder_flush(b);
+}
+
+/* Write the end segment of the innermost open container */
+static int
+edi__builder_close(edi_builder_t *b)
+{
+	edi_segment_t *seg;
+	
+	edi__interchange_reset(b->trailer);
+	if(NULL == (seg = edi_segment_create(b->trailer, b->containers[b->stack[b->depth - 1].container].end)))
+	{
+		b->error = 1;
+		return -1;
+	}
+	return edi__builder_commit(b, seg);
+}
+
+/* Update the open containers to account for @seg, completing it if it's an
+ * end segment with no data elements, and write it out.
+ */
+static int
+edi__builder_commit(edi_builder_t *b, edi_segment_t *seg)
+{
+	edi_buildlevel_t *lp;
+	const char *v;
+	char count[32];
+	size_t c, n, len;
+	
+	if(NULL != seg->tag)
+	{
+		for(c = b->depth; c > 0; c--)
+		{
+			if(0 == strcmp(seg->tag, b->containers[b->stack[c - 1].container].end))
+			{
+				break;
+			}
+		}
+		if(c)
+		{
+			/* Close any containers left open within this one first */
+			while(b->depth > c)
+			{
+				if(-1 == edi__builder_close(b))
+				{
+					return -1;
+				}
+			}
+			for(n = 0; n < b->depth; n++)
+			{
+				b->stack[n].nsegments++;
+			}
+			lp = &(b->stack[b->depth - 1]);
+			if(1 == seg->nelements)
+			{
+				sprintf(count, "%lu", (unsigned long) (lp->container + 1 == b->ncontainers ? lp->nsegments : lp->nchildren));
+				if(NULL == edi_element_create(seg, count) ||
+					(NULL != lp->ref && NULL == edi_element_create(seg, lp->ref)))
+				{
+					b->error = 1;
+					return -1;
+				}
+			}
+			free(lp->ref);
+			b->depth--;
+			return edi__builder_emit(b, seg);
+		}
+		for(c = 0; c < b->ncontainers; c++)
+		{
+			if(0 == strcmp(seg->tag, b->containers[c].start))
+			{
+				break;
+			}
+		}
+		if(c < b->ncontainers)
+		{
+			if(b->depth >= BUILDER_DEPTH)
+			{
+				b->error = 1;
+				return -1;
+			}
+			if(b->depth)
+			{
+				b->stack[b->depth - 1].nchildren++;
+			}
+			lp = &(b->stack[b->depth]);
+			memset(lp, 0, sizeof(edi_buildlevel_t));
+			lp->container = c;
+			n = b->containers[c].ref;
+			if(n && n < seg->nelements)
+			{
+				/* An empty reference element leaves lp->ref NULL, so
+				 * that the end segment carries no reference either.
+				 */
+				if(NULL != (v = edi__builder_refvalue(&(seg->elements[n]), &len)))
+				{
+					if(NULL == (lp->ref = (char *) malloc(len + 1)))
+					{
+						b->error = 1;
+						return -1;
+					}
+					memcpy(lp->ref, v, len);
+					lp->ref[len] = 0;
+				}
+			}
+			b->depth++;
+		}
+	}
+	for(n = 0; n < b->depth; n++)
+	{
+		b->stack[n].nsegments++;
+	}
+	return edi__builder_emit(b, seg);
+}
+
+/* Serialize @seg into the output buffer, flushing it first if necessary */
+static int
+edi__builder_emit(edi_builder_t *b, const edi_segment_t *seg)
+{
+	edi_sink_t sink;
+	unsigned char *p;
+	size_t n;
+	int first;
+	
+	first = (b->segstart == b->nsegments);
+	sink.buf = b->buf + b->buflen;
+	sink.buflen = b->bufalloc - b->buflen;
+	sink.pos = 0;
+	sink.iov = NULL;
+	edi__emit_segment(&(b->em), &sink, seg, first);
+	if(sink.pos > sink.buflen)
+	{
+		if(-1 == edi__builder_flush(b))
+		{
+			return -1;
+		}
+		if(sink.pos > b->bufalloc)
+		{
+			for(n = b->bufalloc * 2; n < sink.pos; n *= 2)
+			{
+			}
+			if(NULL == (p = (unsigned char *) realloc(b->buf, n)))
+			{
+				b->error = 1;
+				return -1;
+			}
+			b->buf = p;
+			b->bufalloc = n;
+		}
+		sink.buf = b->buf;
+		sink.buflen = b->bufalloc;
+		sink.pos = 0;
+		edi__emit_segment(&(b->em), &sink, seg, first);
+	}
+	b->buflen += sink.pos;
+	b->noctets += sink.pos;
+	b->nsegments++;
+	return 0;
+}
+
+/* Pass the contents of the output buffer to the sink */
+static int
+edi__builder_flush(edi_builder_t *b)
+{
+	if(b->error)
+	{
+		return -1;
+	}
+	if(b->buflen && -1 == b->cb(b->data, (const char *) b->buf, b->buflen))
+	{
+		b->error = 1;
+		return -1;
+	}
+	b->buflen = 0;
+	return 0;
+}
+
+static int
+edi__builder_write_file(void *data, const char *buf, size_t len)
+{
+	if(len != fwrite(buf, 1, len, (FILE *) data))
+	{
+		return -1;
+	}
+	return 0;
+}
+
+#ifdef HAVE_UNISTD_H
+static int
+edi__builder_write_fd(void *data, const char *buf, size_t len)
+{
+	ssize_t r;
+	
+	while(len)
+	{
+		if(-1 == (r = write(*(int *) data, buf, len)))
+		{
+			if(EINTR == errno)
+			{
+				continue;
+			}
+			return -1;
+		}
+		buf += r;
+		len -= r;
+	}
+	return 0;
+}
+#endif
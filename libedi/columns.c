@@ -0,0 +1,216 @@
+/* @(#) $Id$ */
+
+/*
+ * Copyright (c) 2003, 2004, 2005, 2006, 2007, 2008 Mo McRoberts.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) of this software may not be used to endorse
+ *    or promote products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY 
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * AUTHORS OF THIS SOFTWARE BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF 
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS 
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "p_libedi.h"
+
+/* Ensure that each column of @cols has room for one more row, given that
+ * @rowalloc rows have been allocated.
+ */
+static int
+edi__columns_grow(edi_columns_t *cols, size_t *rowalloc)
+{
+	edi_column_t *col;
+	size_t *op, c, n;
+	unsigned char *vp;
+	
+	if(cols->nrows + 1 <= *rowalloc)
+	{
+		return 0;
+	}
+	n = *rowalloc * 2;
+	for(c = 0; c < cols->ncolumns; c++)
+	{
+		col = &(cols->columns[c]);
+		if(NULL == (op = (size_t *) realloc(col->offsets, sizeof(size_t) * (n + 1))))
+		{
+			return -1;
+		}
+		col->offsets = op;
+		if(NULL == (vp = (unsigned char *) realloc(col->validity, (n + 7) / 8)))
+		{
+			return -1;
+		}
+		memset(vp + (*rowalloc + 7) / 8, 0, (n + 7) / 8 - (*rowalloc + 7) / 8);
+		col->validity = vp;
+	}
+	*rowalloc = n;
+	return 0;
+}
+
+/* Append a row holding @results to @cols */
+static int
+edi__columns_row(edi_columns_t *cols, const edi_result_t *results, size_t *dataalloc, size_t *rowalloc)
+{
+	edi_column_t *col;
+	size_t c, len, n;
+	char *p;
+	
+	if(-1 == edi__columns_grow(cols, rowalloc))
+	{
+		return -1;
+	}
+	for(c = 0; c < cols->ncolumns; c++)
+	{
+		col = &(cols->columns[c]);
+		len = col->offsets[cols->nrows];
+		if(NULL == results[c].value)
+		{
+			col->nnull++;
+			col->offsets[cols->nrows + 1] = len;
+			continue;
+		}
+		if(len + results[c].len > dataalloc[c])
+		{
+			for(n = dataalloc[c] * 2; n < len + results[c].len; n *= 2);
+			if(NULL == (p = (char *) realloc(col->data, n)))
+			{
+				return -1;
+			}
+			col->data = p;
+			dataalloc[c] = n;
+		}
+		memcpy(col->data + len, results[c].value, results[c].len);
+		col->offsets[cols->nrows + 1] = len + results[c].len;
+		col->validity[cols->nrows / 8] |= (unsigned char) (1 << (cols->nrows % 8));
+	}
+	cols->nrows++;
+	return 0;
+}
+
+edi_columns_t *
+edi_columns_extract(const edi_interchange_t *msg, const edi_group_t *group, const char *rowtag, const char *const *paths, size_t npaths)
+{
+	edi_columns_t *cols;
+	edi_query_t *q;
+	edi_result_t *results;
+	const edi_group_t *rowgroup;
+	const edi_segment_t *seg;
+	size_t *dataalloc, rowalloc, rowlast, c, end;
+	unsigned long rowcode;
+	int inrow, err;
+	
+	if(NULL == (q = edi_query_compile(paths, npaths, NULL)))
+	{
+		return NULL;
+	}
+	results = (edi_result_t *) calloc(npaths + 1, sizeof(edi_result_t));
+	dataalloc = (size_t *) calloc(npaths + 1, sizeof(size_t));
+	cols = (edi_columns_t *) calloc(1, sizeof(edi_columns_t));
+	if(NULL == results || NULL == dataalloc || NULL == cols ||
+		NULL == (cols->columns = (edi_column_t *) calloc(npaths + 1, sizeof(edi_column_t))))
+	{
+		free(results);
+		free(dataalloc);
+		free(cols);
+		edi_query_destroy(q);
+		return NULL;
+	}
+	cols->ncolumns = npaths;
+	err = 0;
+	rowalloc = COLUMN_BLOCKSIZE;
+	for(c = 0; c < npaths && !err; c++)
+	{
+		dataalloc[c] = COLUMN_BLOCKSIZE * 8;
+		cols->columns[c].offsets = (size_t *) calloc(rowalloc + 1, sizeof(size_t));
+		cols->columns[c].validity = (unsigned char *) calloc((rowalloc + 7) / 8, 1);
+		cols->columns[c].data = (char *) malloc(dataalloc[c]);
+		err = (NULL == cols->columns[c].offsets || NULL == cols->columns[c].validity || NULL == cols->columns[c].data);
+	}
+	c = 0;
+	end = msg->nsegments;
+	if(NULL != group)
+	{
+		c = group->start;
+		if((size_t) -1 != group->end && group->end < end)
+		{
+			end = group->end + 1;
+		}
+	}
+	rowcode = edi_tag_code(rowtag);
+	rowlast = 0;
+	inrow = 0;
+	for(; c < end && !err; c++)
+	{
+		seg = &(msg->segments[c]);
+		if(inrow && c > rowlast)
+		{
+			/* Rows do not extend beyond the container they began in */
+			err = edi__columns_row(cols, results, dataalloc, &rowalloc);
+			inrow = 0;
+		}
+		if(edi__container_match(seg, rowtag, rowcode))
+		{
+			if(inrow)
+			{
+				err = edi__columns_row(cols, results, dataalloc, &rowalloc);
+			}
+			memset(results, 0, sizeof(edi_result_t) * npaths);
+			rowgroup = edi_segment_group(seg);
+			rowlast = (NULL == rowgroup || (size_t) -1 == rowgroup->end ? end - 1 : rowgroup->end);
+			inrow = 1;
+		}
+		if(inrow)
+		{
+			edi_query_segment(q, seg, c, results);
+		}
+	}
+	if(inrow && !err)
+	{
+		err = edi__columns_row(cols, results, dataalloc, &rowalloc);
+	}
+	free(results);
+	free(dataalloc);
+	edi_query_destroy(q);
+	if(err)
+	{
+		edi_columns_destroy(cols);
+		return NULL;
+	}
+	return cols;
+}
+
+int
+edi_columns_destroy(edi_columns_t *cols)
+{
+	size_t c;
+	
+	for(c = 0; c < cols->ncolumns; c++)
+	{
+		free(cols->columns[c].offsets);
+		free(cols->columns[c].data);
+		free(cols->columns[c].validity);
+	}
+	free(cols->columns);
+	free(cols);
+	return 0;
+}
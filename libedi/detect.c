@@ -31,26 +31,115 @@
 # include "config.h"
 #endif
 
+#include <ctype.h>
+
 #include "p_libedi.h"
 
 #include "edifact.h"
 #include "tradacoms.h"
 #include "x12.h"
 
-static size_t ndetectparams;
-static edi_regparams_t **detectparams;
+/* The registry is published as an immutable snapshot: readers (detection and
+ * look-ups) never take a lock, while writers, serialised by registerlock,
+ * build a modified copy and swap it in. Registered parameter sets are never
+ * modified or freed once published, because edi_detect_get() hands out
+ * pointers to them; superseded snapshots are freed once no reader can be
+ * using them.
+ */
+
+typedef struct edi_registry_struct edi_registry_t;
+
+typedef struct edi_matchclass_struct edi_matchclass_t;
+typedef struct edi_matchent_struct edi_matchent_t;
+
+struct edi_matchent_struct
+{
+	const edi_regparams_t *params;
+	const edi_detector_t *detector;
+	size_t order; /* Registration order */
+};
+
+/* Detectors which share a position and detection string length */
+struct edi_matchclass_struct
+{
+	size_t position;
+	size_t length;
+	size_t mask;
+	edi_matchent_t *table;
+};
+
+typedef struct edi_partner_struct edi_partner_t;
+
+# define SENDER_MAX                    35
+
+/* A partner profile: an interchange sender identifier and the parameters
+ * used for interchanges from that sender.
+ */
+struct edi_partner_struct
+{
+	char sender[SENDER_MAX + 1];
+	const edi_regparams_t *params;
+};
+
+struct edi_registry_struct
+{
+	size_t nparams;
+	edi_regparams_t **params;
+	size_t nclasses;
+	edi_matchclass_t *classes;
+	size_t npartners;
+	size_t partnermask;
+	edi_partner_t *partners; /* Hash table, keyed on sender */
+	edi_registry_t *retired; /* Next superseded snapshot awaiting reclamation */
+};
+
+static edi_registry_t emptyregistry;
+static edi_registry_t *registry = &emptyregistry;
+static edi_registry_t *retired;
 #ifdef LIBEDI_USE_PTHREAD
-static pthread_mutex_t detectlock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t registerlock = PTHREAD_MUTEX_INITIALIZER;
 #endif
 
+#if defined(LIBEDI_USE_PTHREAD) && defined(HAVE_ATOMIC_BUILTINS)
+# define REGISTRY_HAZARDS              1
+
+typedef struct edi_hazard_struct edi_hazard_t;
+
+/* Each reading thread owns a hazard slot naming the snapshot it is using.
+ * Slots are never freed, but are recycled once their owning thread exits.
+ */
+struct edi_hazard_struct
+{
+	edi_registry_t *snapshot;
+	int inuse;
+	edi_hazard_t *next;
+};
+
+static edi_hazard_t *hazards;
+static pthread_once_t hazardonce = PTHREAD_ONCE_INIT;
+static pthread_key_t hazardkey;
 
-static inline void edi__detect_lock(void);
-static inline void edi__detect_unlock(void);
-static int edi__detect_regset(const char *name, const edi_params_t *src, const edi_detector_t *detectors);
-static edi_regparams_t *edi__detect_register_params(const char *name, const edi_params_t *params);
-static int edi__detect_register(edi_regparams_t *params, const edi_detector_t *detector);
-static int edi__detect_regset(const char *name, const edi_params_t *src, const edi_detector_t *detectors);
-static int edi__detect_rp_init(edi_regparams_t *dest, const edi_params_t *params);
+static void edi__hazard_init(void);
+static void edi__hazard_exit(void *ptr);
+static edi_hazard_t *edi__hazard_get(void);
+static int edi__hazard_inuse(const edi_registry_t *r);
+#endif
+
+static inline void edi__registry_lock(void);
+static inline void edi__registry_unlock(void);
+static edi_registry_t *edi__registry_acquire(void);
+static void edi__registry_release(edi_registry_t *r);
+static void edi__registry_publish(edi_registry_t *r);
+static void edi__registry_free(edi_registry_t *r);
+static edi_registry_t *edi__registry_copy(size_t extraparams, size_t extrapartners);
+static int edi__registry_compile(edi_registry_t *r);
+static void edi__registry_partner_set(edi_registry_t *r, const char *sender, const edi_regparams_t *params);
+static const edi_partner_t *edi__registry_partner_get(const edi_registry_t *r, const char *sender, size_t len);
+static size_t edi__detect_sender(const char *message, size_t len, const edi_detector_t *d, const edi_params_t *params, const char **sender);
+static size_t edi__detect_hash(const char *p, size_t len);
+static edi_regparams_t *edi__detect_regset(const char *name, const edi_params_t *src, const edi_detector_t *detectors);
+static int edi__detect_params_copy(edi_params_t *dest, const edi_params_t *src);
+static int edi__detect_rp_init(edi_regparams_t *dest, const char *name, const edi_params_t *params, const edi_detector_t *detectors);
 static int edi__detect_rp_cleanup(edi_regparams_t *rp);
 
 int
@@ -70,30 +159,79 @@ edi_params_register(const char *name, const edi_params_t *params)
 	{
 		return NULL;
 	}
-	return edi__detect_register_params(name, params);
+	return edi__detect_regset(name, params, NULL);
+}
+
+/* Register a set of parameters along with a NULL-terminated list of
+ * detectors used to recognise interchanges which use them.
+ */
+edi_regparams_t *
+edi_params_register_detect(const char *name, const edi_params_t *params, const edi_detector_t *detectors)
+{
+	if(-1 == edi__init())
+	{
+		return NULL;
+	}
+	return edi__detect_regset(name, params, detectors);
+}
+
+/* Register a partner profile */
+int
+edi_partner_register(const char *sender, const edi_regparams_t *params)
+{
+	edi_registry_t *r;
+	
+	if(-1 == edi__init())
+	{
+		return -1;
+	}
+	if(NULL == sender || !sender[0] || strlen(sender) > SENDER_MAX || NULL == params)
+	{
+		return -1;
+	}
+	edi__registry_lock();
+	if(NULL == (r = edi__registry_copy(0, 1)))
+	{
+		edi__registry_unlock();
+		return -1;
+	}
+	edi__registry_partner_set(r, sender, params);
+	if(-1 == edi__registry_compile(r))
+	{
+		edi__registry_unlock();
+		edi__registry_free(r);
+		return -1;
+	}
+	edi__registry_publish(r);
+	edi__registry_unlock();
+	return 0;
 }
 
 const edi_regparams_t *
 edi_detect_get(const char *name)
 {
 	size_t c;
+	edi_registry_t *r;
 	const edi_regparams_t *p;
 	
 	if(-1 == edi__init())
 	{
 		return NULL;
 	}
+	if(NULL == (r = edi__registry_acquire()))
+	{
+		return NULL;
+	}
 	p = NULL;
-	edi__detect_lock();
-	for(c = 0; c < ndetectparams; c++)
+	for(c = 0; c < r->nparams; c++)
 	{
-		if(detectparams[c]->name[0] && 0 == strcmp(name, detectparams[c]->name))
+		if(r->params[c]->name[0] && 0 == strcmp(name, r->params[c]->name))
 		{
-			p = detectparams[c];
+			p = r->params[c];
 			break;
 		}
 	}
-	edi__detect_unlock();
+	edi__registry_release(r);
 	return p;
 }
 
@@ -109,208 +247,625 @@ edi_detect_get_params(const char *name)
 	return &(p->params);
 }
 
+/* Return 1 if every separator position of @d, which matched at its
+ * position, lies within @len octets of message.
+ */
+static int
+edi__detect_fits(const edi_detector_t *d, size_t len)
+{
+	const size_t pos[5] = { d->segment_separator_pos, d->element_separator_pos,
+		d->subelement_separator_pos, d->tag_separator_pos, d->escape_pos };
+	size_t c;
+	
+	if(d->skipbytes > len)
+	{
+		return 0;
+	}
+	for(c = 0; c < 5; c++)
+	{
+		if(pos[c] && d->position + pos[c] >= len)
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* Return 1 if the separators which @d reads from @message are plausible:
+ * none is alphanumeric or NUL, and those read from different positions
+ * differ (e.g., UNB+UNOA+... has no sub-element separator at position 8).
+ */
+static int
+edi__detect_plausible(const edi_detector_t *d, const char *message)
+{
+	const size_t pos[5] = { d->segment_separator_pos, d->element_separator_pos,
+		d->subelement_separator_pos, d->tag_separator_pos, d->escape_pos };
+	unsigned char ch;
+	size_t c, e;
+	
+	for(c = 0; c < 5; c++)
+	{
+		if(!pos[c])
+		{
+			continue;
+		}
+		ch = (unsigned char) message[d->position + pos[c]];
+		if(!ch || isalnum(ch))
+		{
+			return 0;
+		}
+		for(e = 0; e < c; e++)
+		{
+			if(pos[e] && pos[e] != pos[c] && (unsigned char) message[d->position + pos[e]] == ch)
+			{
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
 /* If we do detection, fill in @params, else leave it alone. If the matched
- * detector specified skipbytes, store this in @skip.
+ * detector specified skipbytes, store this in @skip. If @rp is not NULL, it
+ * receives the registered parameters which were used.
  */
 
 int
-edi__detect(edi_parser_t *parser, const char *message, edi_params_t *params, size_t *skip)
+edi__detect(const edi_parser_t *parser, const char *message, size_t len, edi_params_t *params, size_t *skip, const edi_regparams_t **rp)
 {
-	size_t len, c, n;
-	edi_params_t *p;
-	edi_detector_t *d;
+	size_t c, h, bestlen;
+	edi_registry_t *r;
+	const edi_matchent_t *e, *best;
+	const edi_matchclass_t *mc;
+	const edi_detector_t *d;
+	const edi_partner_t *partner;
+	const char *sender;
 	
 	(void) parser;
 	
-	len = strlen(message);
-	edi__detect_lock();
-	for(c = 0; c < ndetectparams; c++)
+	if(NULL == (r = edi__registry_acquire()))
+	{
+		return -1;
+	}
+	/* Probe each class of detectors which could fit within the message;
+	 * where several match, the one with the longest detection string
+	 * wins, then the earliest-registered.
+	 */
+	best = NULL;
+	bestlen = 0;
+	for(c = 0; c < r->nclasses; c++)
 	{
-		p = &(detectparams[c]->params);
-		for(n = 0; n < detectparams[c]->ndetectors; n++)
+		mc = &(r->classes[c]);
+		if(mc->position > len || mc->length > len - mc->position)
 		{
-			d = &(detectparams[c]->detectors[n]);
-			if(d->position > len || d->position + strlen(d->detectstr) > len || d->skipbytes > len)
-			{
-				continue;
-			}
-			if(0 == strncmp(d->detectstr, message, strlen(d->detectstr)))
+			continue;
+		}
+		for(h = edi__detect_hash(message + mc->position, mc->length) & mc->mask; NULL != mc->table[h].detector; h = (h + 1) & mc->mask)
+		{
+			e = &(mc->table[h]);
+			if(0 == memcmp(e->detector->detectstr, message + mc->position, mc->length))
 			{
-				/* We have a match */
-				*skip = d->skipbytes;
-				memset(params, 0, sizeof(params));
-				params->version = EDI_VERSION;
-				params->segment_separator = p->segment_separator;
-				params->element_separator = p->element_separator;
-				params->subelement_separator = p->subelement_separator;
-				params->tag_separator = p->tag_separator;
-				params->escape = p->escape;
-				if(d->segment_separator_pos)
+				/* A message too short to hold the separators the
+				 * detector reads cannot be detected by it.
+				 */
+				if(!edi__detect_fits(e->detector, len))
 				{
-					params->segment_separator = message[d->position + d->segment_separator_pos];
-/*					fprintf(stderr, "segment separator is %c\n", params->segment_separator); */
-				}
-				if(d->element_separator_pos)
-				{
-					params->element_separator = message[d->position + d->element_separator_pos];
-/*					fprintf(stderr, "element separator is %c\n", params->element_separator); */
+					break;
 				}
-				if(d->subelement_separator_pos)
+				if(NULL == best || mc->length > bestlen ||
+					(mc->length == bestlen && e->order < best->order))
 				{
-					params->subelement_separator = message[d->position + d->subelement_separator_pos];
-/*					fprintf(stderr, "sub-element separator is %c\n", params->subelement_separator); */
-					
+					best = e;
+					bestlen = mc->length;
 				}
-				if(d->tag_separator_pos)
+				break;
+			}
+		}
+	}
+	if(NULL == best)
+	{
+		/* No match */
+		edi__registry_release(r);
+		return 0;
+	}
+	d = best->detector;
+	*skip = d->skipbytes;
+	/* String members continue to refer to the registered parameters */
+	memcpy(params, &(best->params->params), sizeof(edi_params_t));
+	params->version = EDI_VERSION;
+	if(NULL != rp)
+	{
+		*rp = best->params;
+	}
+	/* Separators which don't look like separators are ignored in favour
+	 * of the defaults of the registered parameters.
+	 */
+	if(edi__detect_plausible(d, message))
+	{
+		if(d->segment_separator_pos)
+		{
+			params->segment_separator = message[d->position + d->segment_separator_pos];
+		}
+		if(d->element_separator_pos)
+		{
+			params->element_separator = message[d->position + d->element_separator_pos];
+		}
+		if(d->subelement_separator_pos)
+		{
+			params->subelement_separator = message[d->position + d->subelement_separator_pos];
+		}
+		if(d->tag_separator_pos)
+		{
+			params->tag_separator = message[d->position + d->tag_separator_pos];
+		}
+		if(d->escape_pos)
+		{
+			params->escape = message[d->position + d->escape_pos];
+		}
+	}
+	/* A partner profile for the sender takes precedence over whatever the
+	 * header suggests.
+	 */
+	if(d->sender_element && r->npartners)
+	{
+		if(0 != (len = edi__detect_sender(message, len, d, params, &sender)) &&
+			NULL != (partner = edi__registry_partner_get(r, sender, len)))
+		{
+			memcpy(params, &(partner->params->params), sizeof(edi_params_t));
+			params->version = EDI_VERSION;
+			if(NULL != rp)
+			{
+				*rp = partner->params;
+			}
+		}
+	}
+	edi__registry_release(r);
+	return 0;
+}
+
+/* Locate the interchange sender identifier within the header matched by @d,
+ * using the separators in @params. Returns its length (less any trailing
+ * padding), or zero if it can't be found.
+ */
+static size_t
+edi__detect_sender(const char *message, size_t len, const edi_detector_t *d, const edi_params_t *params, const char **sender)
+{
+	const char *p, *end;
+	size_t n;
+	
+	end = message + len;
+	/* Skip the tag and tag separator */
+	p = message + d->position + strlen(d->detectstr) + 1;
+	for(n = 1; n < d->sender_element; p++)
+	{
+		if(p >= end || *p == params->segment_separator)
+		{
+			return 0;
+		}
+		if(params->escape && *p == params->escape)
+		{
+			p++;
+			continue;
+		}
+		if(*p == params->element_separator)
+		{
+			n++;
+		}
+	}
+	*sender = p;
+	for(; p < end && *p != params->element_separator && *p != params->subelement_separator && *p != params->segment_separator; p++);
+	for(n = p - *sender; n && ' ' == (*sender)[n - 1]; n--);
+	if(n > SENDER_MAX)
+	{
+		return 0;
+	}
+	return n;
+}
+
+static size_t
+edi__detect_hash(const char *p, size_t len)
+{
+	size_t h;
+	
+	/* FNV-1a */
+	for(h = 2166136261U; len; p++, len--)
+	{
+		h = (h ^ (unsigned char) *p) * 16777619U;
+	}
+	return h;
+}
+
+/* Build the matcher for a snapshot: detectors are grouped into classes
+ * sharing the same position and detection string length, each of which is
+ * indexed by a hash table keyed on the detection string, so that detection
+ * costs one probe per class regardless of how many detectors are registered.
+ */
+static int
+edi__registry_compile(edi_registry_t *r)
+{
+	size_t c, n, k, order, len, h;
+	edi_matchclass_t *mc;
+	const edi_detector_t *d;
+	
+	for(c = 0; c < r->nparams; c++)
+	{
+		for(n = 0; n < r->params[c]->ndetectors; n++)
+		{
+			d = &(r->params[c]->detectors[n]);
+			len = strlen(d->detectstr);
+			for(k = 0; k < r->nclasses; k++)
+			{
+				if(r->classes[k].position == d->position && r->classes[k].length == len)
 				{
-					params->tag_separator = message[d->position + d->tag_separator_pos];
-/*					fprintf(stderr, "tag separator is %c\n", params->tag_separator); */
-					
+					break;
 				}
-				if(d->escape_pos)
+			}
+			if(k == r->nclasses)
+			{
+				if(NULL == (mc = (edi_matchclass_t *) realloc(r->classes, sizeof(edi_matchclass_t) * (r->nclasses + 1))))
 				{
-					params->escape = message[d->position + d->escape_pos];
-/*					fprintf(stderr, "release is %c\n", params->escape); */
+					return -1;
 				}
-				edi__detect_unlock();
-				return 0;
+				r->classes = mc;
+				memset(&(mc[k]), 0, sizeof(edi_matchclass_t));
+				mc[k].position = d->position;
+				mc[k].length = len;
+				r->nclasses++;
 			}
+			/* Use mask to count members for now */
+			r->classes[k].mask++;
+		}
+	}
+	for(k = 0; k < r->nclasses; k++)
+	{
+		/* Keep the load factor at or below one half */
+		for(n = 4; n < r->classes[k].mask * 2; n <<= 1);
+		r->classes[k].mask = n - 1;
+		if(NULL == (r->classes[k].table = (edi_matchent_t *) calloc(n, sizeof(edi_matchent_t))))
+		{
+			return -1;
+		}
+	}
+	order = 0;
+	for(c = 0; c < r->nparams; c++)
+	{
+		for(n = 0; n < r->params[c]->ndetectors; n++, order++)
+		{
+			d = &(r->params[c]->detectors[n]);
+			len = strlen(d->detectstr);
+			for(k = 0; r->classes[k].position != d->position || r->classes[k].length != len; k++);
+			mc = &(r->classes[k]);
+			/* Linear probing, inserting in registration order, means
+			 * that among detectors with the same string the earliest
+			 * is found first.
+			 */
+			for(h = edi__detect_hash(d->detectstr, len) & mc->mask; NULL != mc->table[h].detector; h = (h + 1) & mc->mask);
+			mc->table[h].params = r->params[c];
+			mc->table[h].detector = d;
+			mc->table[h].order = order;
 		}
 	}
-	/* No match */
-	edi__detect_unlock();
 	return 0;
 }
 
 static inline void
-edi__detect_lock(void)
+edi__registry_lock(void)
 {
 #ifdef LIBEDI_USE_PTHREAD
-	pthread_mutex_lock(&detectlock);
+	pthread_mutex_lock(&registerlock);
 #endif
 }
 
 static inline void
-edi__detect_unlock(void)
+edi__registry_unlock(void)
 {
 #ifdef LIBEDI_USE_PTHREAD
-	pthread_mutex_unlock(&detectlock);
+	pthread_mutex_unlock(&registerlock);
 #endif
 }
 
-static edi_regparams_t *
-edi__detect_register_params(const char *name, const edi_params_t *params)
+/* Obtain the current snapshot of the registry, which remains valid until it
+ * is passed to edi__registry_release().
+ */
+static edi_registry_t *
+edi__registry_acquire(void)
+{
+#ifdef REGISTRY_HAZARDS
+	edi_hazard_t *h;
+	edi_registry_t *r;
+	
+	if(NULL == (h = edi__hazard_get()))
+	{
+		return NULL;
+	}
+	/* Once the hazard is visible, the snapshot can't be reclaimed, but it
+	 * may have been superseded (and retired) before then.
+	 */
+	do
+	{
+		r = __atomic_load_n(&registry, __ATOMIC_ACQUIRE);
+		__atomic_store_n(&(h->snapshot), r, __ATOMIC_SEQ_CST);
+	}
+	while(r != __atomic_load_n(&registry, __ATOMIC_SEQ_CST));
+	return r;
+#else
+	/* Without atomic operations, fall back to locking */
+	edi__registry_lock();
+	return registry;
+#endif
+}
+
+static void
+edi__registry_release(edi_registry_t *r)
+{
+#ifdef REGISTRY_HAZARDS
+	edi_hazard_t *h;
+	
+	(void) r;
+	
+	h = (edi_hazard_t *) pthread_getspecific(hazardkey);
+	__atomic_store_n(&(h->snapshot), NULL, __ATOMIC_RELEASE);
+#else
+	(void) r;
+	
+	edi__registry_unlock();
+#endif
+}
+
+/* Replace the current snapshot with @r; must be called with registerlock
+ * held.
+ */
+static void
+edi__registry_publish(edi_registry_t *r)
+{
+	edi_registry_t *old, **rp, *p;
+	
+	old = registry;
+#ifdef REGISTRY_HAZARDS
+	__atomic_store_n(&registry, r, __ATOMIC_SEQ_CST);
+#else
+	registry = r;
+#endif
+	if(old != &emptyregistry)
+	{
+		old->retired = retired;
+		retired = old;
+	}
+	for(rp = &retired; NULL != (p = *rp); )
+	{
+#ifdef REGISTRY_HAZARDS
+		if(edi__hazard_inuse(p))
+		{
+			rp = &(p->retired);
+			continue;
+		}
+#endif
+		*rp = p->retired;
+		edi__registry_free(p);
+	}
+}
+
+static void
+edi__registry_free(edi_registry_t *r)
 {
 	size_t c;
-	char tbuf[32];
-	edi_regparams_t *p, **q;
 	
-	if(NULL != name)
+	for(c = 0; c < r->nclasses; c++)
 	{
-		strncpy(tbuf, name, sizeof(tbuf));
-		tbuf[sizeof(tbuf) - 1] = 0;
+		free(r->classes[c].table);
 	}
-	edi__detect_lock();
-	if(NULL != name)
+	free(r->classes);
+	free(r->partners);
+	free(r->params);
+	free(r);
+}
+
+/* Create an uncompiled copy of the current snapshot with room for a number
+ * of additional parameter sets and partner profiles; must be called with
+ * registerlock held.
+ */
+static edi_registry_t *
+edi__registry_copy(size_t extraparams, size_t extrapartners)
+{
+	size_t c, n;
+	edi_registry_t *r;
+	
+	if(NULL == (r = (edi_registry_t *) calloc(1, sizeof(edi_registry_t))))
 	{
-		for(c = 0; c < ndetectparams; c++)
+		return NULL;
+	}
+	if(NULL == (r->params = (edi_regparams_t **) malloc(sizeof(edi_regparams_t *) * (registry->nparams + extraparams + 1))))
+	{
+		free(r);
+		return NULL;
+	}
+	r->nparams = registry->nparams;
+	if(r->nparams)
+	{
+		memcpy(r->params, registry->params, sizeof(edi_regparams_t *) * r->nparams);
+	}
+	n = registry->npartners + extrapartners;
+	if(n)
+	{
+		/* Keep the load factor at or below one half */
+		for(c = 4; c < n * 2; c <<= 1);
+		if(NULL == (r->partners = (edi_partner_t *) calloc(c, sizeof(edi_partner_t))))
+		{
+			edi__registry_free(r);
+			return NULL;
+		}
+		r->partnermask = c - 1;
+		for(c = 0; registry->npartners && c <= registry->partnermask; c++)
 		{
-			if(0 != detectparams[c]->name[0])
+			if(registry->partners[c].sender[0])
 			{
-				if(0 == strcmp(detectparams[c]->name, tbuf))
-				{
-					break;
-				}
+				edi__registry_partner_set(r, registry->partners[c].sender, registry->partners[c].params);
 			}
 		}
-		if(c < ndetectparams)
+	}
+	return r;
+}
+
+/* Add or replace a partner profile; there must be room for it */
+static void
+edi__registry_partner_set(edi_registry_t *r, const char *sender, const edi_regparams_t *params)
+{
+	size_t h, len;
+	
+	len = strlen(sender);
+	for(h = edi__detect_hash(sender, len) & r->partnermask; r->partners[h].sender[0]; h = (h + 1) & r->partnermask)
+	{
+		if(0 == strcmp(r->partners[h].sender, sender))
 		{
-			edi__detect_rp_cleanup(detectparams[c]);
-			edi__detect_rp_init(detectparams[c], params);
-			p = detectparams[c];
-			edi__detect_unlock();
-			return p;
+			r->partners[h].params = params;
+			return;
 		}
 	}
-	if(NULL == (p = (edi_regparams_t *) calloc(1, sizeof(edi_regparams_t))))
+	strcpy(r->partners[h].sender, sender);
+	r->partners[h].params = params;
+	r->npartners++;
+}
+
+static const edi_partner_t *
+edi__registry_partner_get(const edi_registry_t *r, const char *sender, size_t len)
+{
+	size_t h;
+	
+	for(h = edi__detect_hash(sender, len) & r->partnermask; r->partners[h].sender[0]; h = (h + 1) & r->partnermask)
 	{
-		edi__detect_unlock();
-		return NULL;
+		if(0 == strncmp(r->partners[h].sender, sender, len) && !r->partners[h].sender[len])
+		{
+			return &(r->partners[h]);
+		}
 	}
-	if(NULL == (q = (edi_regparams_t **) realloc(detectparams, sizeof(edi_regparams_t *) * (ndetectparams + 1))))
+	return NULL;
+}
+
+#ifdef REGISTRY_HAZARDS
+static void
+edi__hazard_init(void)
+{
+	pthread_key_create(&hazardkey, edi__hazard_exit);
+}
+
+static void
+edi__hazard_exit(void *ptr)
+{
+	edi_hazard_t *h;
+	
+	h = (edi_hazard_t *) ptr;
+	__atomic_store_n(&(h->snapshot), NULL, __ATOMIC_RELEASE);
+	__atomic_store_n(&(h->inuse), 0, __ATOMIC_RELEASE);
+}
+
+/* Return the calling thread's hazard slot, claiming one if needed */
+static edi_hazard_t *
+edi__hazard_get(void)
+{
+	edi_hazard_t *h;
+	int expect;
+	
+	pthread_once(&hazardonce, edi__hazard_init);
+	if(NULL != (h = (edi_hazard_t *) pthread_getspecific(hazardkey)))
 	{
-		edi__detect_unlock();
-		free(q);
-		return NULL;
+		return h;
 	}
-	detectparams = q;
-	detectparams[ndetectparams] = p;
-	ndetectparams++;
-	edi__detect_rp_init(p, params);
-	if(NULL != name)
+	for(h = __atomic_load_n(&hazards, __ATOMIC_ACQUIRE); NULL != h; h = h->next)
 	{
-		strcpy(p->name, tbuf);
+		expect = 0;
+		if(0 == __atomic_load_n(&(h->inuse), __ATOMIC_RELAXED) &&
+			__atomic_compare_exchange_n(&(h->inuse), &expect, 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+		{
+			break;
+		}
 	}
-	edi__detect_unlock();
-	return p;
+	if(NULL == h)
+	{
+		if(NULL == (h = (edi_hazard_t *) calloc(1, sizeof(edi_hazard_t))))
+		{
+			return NULL;
+		}
+		h->inuse = 1;
+		h->next = __atomic_load_n(&hazards, __ATOMIC_RELAXED);
+		while(!__atomic_compare_exchange_n(&hazards, &(h->next), h, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	}
+	if(0 != pthread_setspecific(hazardkey, h))
+	{
+		__atomic_store_n(&(h->inuse), 0, __ATOMIC_RELEASE);
+		return NULL;
+	}
+	return h;
 }
 
+/* Return 1 if any reader may be using the snapshot @r */
 static int
-edi__detect_regset(const char *name, const edi_params_t *src, const edi_detector_t *detectors)
+edi__hazard_inuse(const edi_registry_t *r)
 {
-	edi_regparams_t *p;
-	size_t c;
+	edi_hazard_t *h;
 	
-	p = edi__detect_register_params(name, src);
-	if(NULL != detectors)
+	for(h = __atomic_load_n(&hazards, __ATOMIC_ACQUIRE); NULL != h; h = h->next)
 	{
-		for(c = 0; NULL != detectors[c].detectstr; c++)
+		if(r == __atomic_load_n(&(h->snapshot), __ATOMIC_SEQ_CST))
 		{
-			edi__detect_register(p, &(detectors[c]));
+			return 1;
 		}
 	}
 	return 0;
 }
+#endif
 
-static int
-edi__detect_register(edi_regparams_t *params, const edi_detector_t *detector)
+/* Create a new parameter set and publish a copy of the registry containing
+ * it, in place of any existing set with the same name.
+ */
+static edi_regparams_t *
+edi__detect_regset(const char *name, const edi_params_t *src, const edi_detector_t *detectors)
 {
-	edi_detector_t *q;
 	size_t c;
+	edi_regparams_t *p;
+	edi_registry_t *r;
 	
-	edi__detect_lock();
-	q = NULL;
-	if(params->ndetectors + 1 > params->nalloc)
+	if(NULL == (p = (edi_regparams_t *) calloc(1, sizeof(edi_regparams_t))))
 	{
-		if(NULL == (q = (edi_detector_t *) realloc(params->detectors, sizeof(edi_detector_t) * (params->ndetectors + 1))))
-		{
-			edi__detect_unlock();
-			return -1;
-		}
-		params->detectors = q;
-		params->nalloc = params->ndetectors + 1;
+		return NULL;
+	}
+	if(-1 == edi__detect_rp_init(p, name, src, detectors))
+	{
+		edi__detect_rp_cleanup(p);
+		free(p);
+		return NULL;
+	}
+	edi__registry_lock();
+	if(NULL == (r = edi__registry_copy(1, 0)))
+	{
+		edi__registry_unlock();
+		edi__detect_rp_cleanup(p);
+		free(p);
+		return NULL;
 	}
-	else
+	for(c = 0; c < r->nparams; c++)
 	{
-		for(c = 0; c < params->ndetectors; c++)
+		if(p->name[0] && 0 == strcmp(r->params[c]->name, p->name))
 		{
-			if(NULL == params->detectors[c].detectstr)
-			{
-				q = &(params->detectors[c]);
-				break;
-			}
+			break;
 		}
 	}
-	q = &(params->detectors[params->ndetectors]);
-	memcpy(q, detector, sizeof(edi_detector_t));
-	if(NULL == (q->detectstr = strdup(detector->detectstr)))
+	/* Any superseded set remains allocated */
+	r->params[c] = p;
+	if(c == r->nparams)
 	{
-		edi__detect_unlock();
-		return -1;
+		r->nparams++;
 	}
-	params->ndetectors++;
-	edi__detect_unlock();
-	return 0;
+	if(-1 == edi__registry_compile(r))
+	{
+		edi__registry_unlock();
+		edi__registry_free(r);
+		edi__detect_rp_cleanup(p);
+		free(p);
+		return NULL;
+	}
+	edi__registry_publish(r);
+	edi__registry_unlock();
+	return p;
 }
 
 static int
@@ -365,21 +920,85 @@ edi__detect_params_copy(edi_params_t *dest, const edi_params_t *src)
 		}
 		
 	}
+	if(src->version >= 0x0104)
+	{
+		if(NULL != src->segment_whitespace)
+		{
+			if(NULL == (dest->segment_whitespace = strdup(src->segment_whitespace)))
+			{
+				return -1;
+			}
+		}
+		if(NULL != src->segment_newline)
+		{
+			if(NULL == (dest->segment_newline = strdup(src->segment_newline)))
+			{
+				return -1;
+			}
+		}
+	}
+	if(src->version >= 0x0105)
+	{
+		if(NULL != src->binary_segments)
+		{
+			if(NULL == (dest->binary_segments = strdup(src->binary_segments)))
+			{
+				return -1;
+			}
+		}
+	}
+	if(src->version >= 0x0106)
+	{
+		dest->max_segments = src->max_segments;
+		dest->max_elements = src->max_elements;
+		dest->max_components = src->max_components;
+		dest->max_value_length = src->max_value_length;
+		dest->max_memory = src->max_memory;
+	}
+	if(src->version >= 0x0107)
+	{
+		dest->index_segments = src->index_segments;
+	}
 	return 0;
 }
 
 static int 
-edi__detect_rp_init(edi_regparams_t *dest, const edi_params_t *params)
+edi__detect_rp_init(edi_regparams_t *dest, const char *name, const edi_params_t *params, const edi_detector_t *detectors)
 {
+	size_t c;
+	
 	memset(dest, 0, sizeof(edi_regparams_t));
+	if(NULL != name)
+	{
+		strncpy(dest->name, name, sizeof(dest->name));
+		dest->name[sizeof(dest->name) - 1] = 0;
+	}
 	dest->params.version = EDI_VERSION;
-	edi__detect_params_copy(&dest->params, params);
-	/* Most in-use EDI flavours need two detectors */
-	dest->nalloc = 2;
-	if(NULL == (dest->detectors = (edi_detector_t *) calloc(dest->nalloc, sizeof(edi_detector_t))))
+	if(-1 == edi__detect_params_copy(&dest->params, params))
+	{
+		return -1;
+	}
+	if(NULL == detectors)
+	{
+		return 0;
+	}
+	for(c = 0; NULL != detectors[c].detectstr; c++);
+	if(!c)
+	{
+		return 0;
+	}
+	if(NULL == (dest->detectors = (edi_detector_t *) calloc(c, sizeof(edi_detector_t))))
 	{
 		return -1;
 	}
+	for(; dest->ndetectors < c; dest->ndetectors++)
+	{
+		memcpy(&(dest->detectors[dest->ndetectors]), &(detectors[dest->ndetectors]), sizeof(edi_detector_t));
+		if(NULL == (dest->detectors[dest->ndetectors].detectstr = strdup(detectors[dest->ndetectors].detectstr)))
+		{
+			return -1;
+		}
+	}
 	return 0;
 }
 
@@ -393,9 +1012,22 @@ edi__detect_rp_cleanup(edi_regparams_t *rp)
 		free((char *) rp->detectors[c].detectstr);
 		rp->detectors[c].detectstr = NULL;
 	}
+	free(rp->detectors);
+	rp->detectors = NULL;
+	rp->ndetectors = 0;
 	free((char *) (rp->params.xml_root_node));
 	rp->params.xml_root_node = NULL;
 	free((char *) (rp->params.containers));
 	rp->params.containers = NULL;
+	free((char *) (rp->params.ss_name));
+	rp->params.ss_name = NULL;
+	free((char *) (rp->params.ss_trailer));
+	rp->params.ss_trailer = NULL;
+	free((char *) (rp->params.segment_whitespace));
+	rp->params.segment_whitespace = NULL;
+	free((char *) (rp->params.segment_newline));
+	rp->params.segment_newline = NULL;
+	free((char *) (rp->params.binary_segments));
+	rp->params.binary_segments = NULL;
 	return 0;
 }
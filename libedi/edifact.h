@@ -39,14 +39,17 @@ UNA:+.? '
  * Escape character is ? (question mark)
  * Segment separator is ' (apostrophe)
  *
- * If UNA is absent, the first segment will be UNB, terminated with UNZ.
+ * If UNA is absent, the first segment will be UNB, terminated with UNZ. In
+ * this case the element and sub-element separators can still be determined
+ * from the syntax identifier (e.g., UNB+UNOA:1), but the segment separator
+ * and release character can only be assumed.
  */
 
 
 static const edi_detector_t edi__edifact_detectors[] = {
-	{ "UNA", 0, 9, 8, 4, 3, 4, 6 },
-	{ "UNB", 0, 0, 0, 0, 0, 0, 0 },
-	{ NULL, 0, 0, 0, 0, 0, 0, 0 }
+	{ "UNA", 0, 9, 8, 4, 3, 4, 6, 0 },
+	{ "UNB", 0, 0, 0, 3, 8, 3, 0, 2 },
+	{ NULL, 0, 0, 0, 0, 0, 0, 0, 0 }
 };
 
 /* This is public because it was in 1.0.1 */
@@ -58,9 +61,18 @@ const edi_params_t edi_edifact_params = {
 	'+',
 	'?',
 	"EDIFACT",
-	"UNB/UNZ,UNG/UNE,UNH/UNT",
+	"UNB/UNZ:5,UNG/UNE:5,UNH/UNT:1",
 	"UNA",
-	"%s%E.%R %S"
+	"%s%E.%R %S",
+	NULL,
+	NULL,
+	NULL,
+	0,
+	0,
+	0,
+	0,
+	0,
+	0
 };
 
 /* Default parameters are based upon EDIFACT */
@@ -74,7 +86,16 @@ const edi_params_t edi__default_params = {
 	'+',
 	'?',
 	"EDIFACT",
-	"UNB/UNZ,UNG/UNE,UNH/UNT",
+	"UNB/UNZ:5,UNG/UNE:5,UNH/UNT:1",
 	NULL, /* Don't output an interchange header by default */
-	NULL
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	0,
+	0,
+	0,
+	0,
+	0,
+	0
 };
@@ -0,0 +1,129 @@
+/* @(#) $Id$ */
+
+/*
+ * Copyright (c) 2003, 2004, 2005, 2006, 2007, 2008 Mo McRoberts.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) of this software may not be used to endorse
+ *    or promote products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY 
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * AUTHORS OF THIS SOFTWARE BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF 
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS 
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "p_libedi.h"
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+/* Prepare @em to escape values: any separator, or the escape character
+ * itself, must be escaped. Nothing is escaped if there is no escape
+ * character.
+ */
+void
+edi__escape_init(edi_emitter_t *em)
+{
+	const edi_params_t *params;
+	
+	params = em->params;
+	em->sep_seg = params->segment_separator;
+	em->sep_data = params->element_separator;
+	em->sep_sub = params->subelement_separator;
+	em->sep_tag = params->tag_separator;
+	em->escape = params->escape;
+	if(!em->escape)
+	{
+		memset(em->special, 0, sizeof(em->special));
+		return;
+	}
+	edi__escape_specials(em);
+}
+
+/* Mark the separators and escape character (if any) of @em as the octets
+ * found by edi__escape_scan().
+ */
+void
+edi__escape_specials(edi_emitter_t *em)
+{
+	size_t c;
+	
+	memset(em->special, 0, sizeof(em->special));
+	em->specials[0] = em->sep_seg;
+	em->specials[1] = em->sep_data;
+	em->specials[2] = em->sep_sub;
+	em->specials[3] = em->sep_tag;
+	em->specials[4] = (em->escape ? em->escape : em->sep_seg);
+	for(c = 0; c < sizeof(em->specials); c++)
+	{
+		em->special[em->specials[c]] = 1;
+	}
+}
+
+/* Return the offset of the first octet of @value which must be escaped, or
+ * @len if there are none. Where SSE2 is available, sixteen octets are
+ * examined at a time.
+ */
+size_t
+edi__escape_scan(const edi_emitter_t *em, const char *value, size_t len)
+{
+	size_t c;
+#ifdef __SSE2__
+	__m128i v, m, s0, s1, s2, s3, s4;
+	int mask;
+	
+	c = 0;
+	if(len >= 16)
+	{
+		s0 = _mm_set1_epi8((char) em->specials[0]);
+		s1 = _mm_set1_epi8((char) em->specials[1]);
+		s2 = _mm_set1_epi8((char) em->specials[2]);
+		s3 = _mm_set1_epi8((char) em->specials[3]);
+		s4 = _mm_set1_epi8((char) em->specials[4]);
+		for(; c + 16 <= len; c += 16)
+		{
+			v = _mm_loadu_si128((const __m128i *) (value + c));
+			m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, s0), _mm_cmpeq_epi8(v, s1)),
+				_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, s2), _mm_cmpeq_epi8(v, s3)), _mm_cmpeq_epi8(v, s4)));
+			if(0 != (mask = _mm_movemask_epi8(m)))
+			{
+				for(; !(mask & 1); mask >>= 1)
+				{
+					c++;
+				}
+				return c;
+			}
+		}
+	}
+#else
+	c = 0;
+#endif
+	for(; c < len; c++)
+	{
+		if(em->special[(unsigned char) value[c]])
+		{
+			break;
+		}
+	}
+	return c;
+}
@@ -0,0 +1,228 @@
+/* @(#) $Id$ */
+
+/*
+ * Copyright (c) 2003, 2004, 2005, 2006, 2007, 2008 Mo McRoberts.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) of this software may not be used to endorse
+ *    or promote products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY 
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * AUTHORS OF THIS SOFTWARE BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF 
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS 
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "p_libedi.h"
+
+/* Return 1 if @seg has the container tag @tag, whose packed code is @code */
+int
+edi__container_match(const edi_segment_t *seg, const char *tag, unsigned long code)
+{
+	if(EDI_TAG_NONE != code)
+	{
+		return (seg->tagcode == code);
+	}
+	return (NULL != seg->tag && 0 == strcmp(seg->tag, tag));
+}
+
+/* Record the effect of the most recently parsed segment of @msg on its
+ * containers, according to the container list of @parser. Returns 0 on
+ * success, -1 on failure.
+ */
+int
+edi__group_segment(const edi_parser_t *parser, edi_interchange_t *msg)
+{
+	edi_interchange_private_t *priv;
+	const edi_segment_t *seg;
+	edi_seginfo_t *info;
+	edi_group_t *gp;
+	size_t g, c, n, *pp;
+	
+	priv = msg->private_;
+	n = msg->nsegments - 1;
+	seg = &(msg->segments[n]);
+	info = &(priv->info[n]);
+	info->group = priv->groupcur;
+	if(NULL == seg->tag)
+	{
+		return 0;
+	}
+	/* An end segment closes its container and any left open within it */
+	for(g = priv->groupcur; g; g = priv->groupparent[g - 1])
+	{
+		c = priv->groups[g - 1].kind;
+		if(edi__container_match(seg, parser->containers[c].end, parser->containers[c].endcode))
+		{
+			priv->groups[g - 1].end = n;
+			info->group = g;
+			priv->groupcur = priv->groupparent[g - 1];
+			return 0;
+		}
+	}
+	for(c = 0; c < parser->ncontainers; c++)
+	{
+		if(!edi__container_match(seg, parser->containers[c].start, parser->containers[c].startcode))
+		{
+			continue;
+		}
+		if(priv->ngroups + 1 > priv->groupalloc)
+		{
+			g = (priv->groupalloc ? priv->groupalloc * 2 : GROUP_BLOCKSIZE);
+			if(NULL == (gp = (edi_group_t *) realloc(priv->groups, sizeof(edi_group_t) * g)))
+			{
+				return -1;
+			}
+			priv->groups = gp;
+			if(NULL == (pp = (size_t *) realloc(priv->groupparent, sizeof(size_t) * g)))
+			{
+				return -1;
+			}
+			priv->groupparent = pp;
+			priv->groupalloc = g;
+		}
+		gp = &(priv->groups[priv->ngroups]);
+		memset(gp, 0, sizeof(edi_group_t));
+		gp->kind = c;
+		gp->start = n;
+		gp->end = (size_t) -1;
+		priv->groupparent[priv->ngroups] = priv->groupcur;
+		priv->ngroups++;
+		priv->groupcur = priv->ngroups;
+		info->group = priv->ngroups;
+		return 0;
+	}
+	return 0;
+}
+
+/* Once parsing is complete, link the containers of @msg to their parents
+ * and children, and list them by kind. Returns 0 on success, -1 on failure.
+ */
+int
+edi__group_finish(edi_interchange_t *msg)
+{
+	edi_interchange_private_t *priv;
+	edi_group_t *gp;
+	size_t c, k, off, next[CONTAINER_MAX];
+	
+	priv = msg->private_;
+	if(!priv->ngroups)
+	{
+		return 0;
+	}
+	priv->grouplinks = (const edi_group_t **) malloc(sizeof(edi_group_t *) * priv->ngroups * 2);
+	if(NULL == priv->grouplinks)
+	{
+		return -1;
+	}
+	/* The first half lists containers grouped by kind, each in order */
+	memset(priv->kindstart, 0, sizeof(priv->kindstart));
+	for(c = 0; c < priv->ngroups; c++)
+	{
+		priv->kindstart[priv->groups[c].kind + 1]++;
+	}
+	for(k = 0; k < CONTAINER_MAX; k++)
+	{
+		priv->kindstart[k + 1] += priv->kindstart[k];
+		next[k] = priv->kindstart[k];
+	}
+	for(c = 0; c < priv->ngroups; c++)
+	{
+		priv->grouplinks[next[priv->groups[c].kind]++] = &(priv->groups[c]);
+	}
+	/* The second half holds the children of each container in turn */
+	for(c = 0; c < priv->ngroups; c++)
+	{
+		if(priv->groupparent[c])
+		{
+			priv->groups[c].parent = &(priv->groups[priv->groupparent[c] - 1]);
+			priv->groups[priv->groupparent[c] - 1].nchildren++;
+		}
+	}
+	for(c = 0, off = priv->ngroups; c < priv->ngroups; c++)
+	{
+		priv->groups[c].children = priv->grouplinks + off;
+		off += priv->groups[c].nchildren;
+		priv->groups[c].nchildren = 0;
+	}
+	for(c = 0; c < priv->ngroups; c++)
+	{
+		if(NULL != (gp = (edi_group_t *) priv->groups[c].parent))
+		{
+			gp->children[gp->nchildren++] = &(priv->groups[c]);
+		}
+	}
+	return 0;
+}
+
+/* Discard the containers recorded for @msg */
+void
+edi__group_destroy(edi_interchange_t *msg)
+{
+	edi_interchange_private_t *priv;
+	
+	priv = msg->private_;
+	free(priv->groups);
+	free(priv->groupparent);
+	free(priv->grouplinks);
+	priv->groups = NULL;
+	priv->groupparent = NULL;
+	priv->grouplinks = NULL;
+	priv->ngroups = 0;
+	priv->groupalloc = 0;
+	priv->groupcur = 0;
+	memset(priv->kindstart, 0, sizeof(priv->kindstart));
+}
+
+size_t
+edi_interchange_ngroups(const edi_interchange_t *msg, size_t kind)
+{
+	if(kind >= CONTAINER_MAX || NULL == msg->private_->grouplinks)
+	{
+		return 0;
+	}
+	return msg->private_->kindstart[kind + 1] - msg->private_->kindstart[kind];
+}
+
+const edi_group_t *
+edi_interchange_group(const edi_interchange_t *msg, size_t kind, size_t n)
+{
+	if(n >= edi_interchange_ngroups(msg, kind))
+	{
+		return NULL;
+	}
+	return msg->private_->grouplinks[msg->private_->kindstart[kind] + n];
+}
+
+const edi_group_t *
+edi_segment_group(const edi_segment_t *seg)
+{
+	const edi_interchange_private_t *priv;
+	size_t g;
+	
+	priv = seg->interchange->private_;
+	g = priv->info[seg - seg->interchange->segments].group;
+	if(!g || NULL == priv->grouplinks)
+	{
+		return NULL;
+	}
+	return &(priv->groups[g - 1]);
+}
@@ -0,0 +1,278 @@
+/* @(#) $Id$ */
+
+/*
+ * Copyright (c) 2003, 2004, 2005, 2006, 2007, 2008 Mo McRoberts.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) of this software may not be used to endorse
+ *    or promote products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY 
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * AUTHORS OF THIS SOFTWARE BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF 
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS 
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "p_libedi.h"
+
+/* FNV-1a, over the tag and, if present, a marker and the qualifier */
+static unsigned long
+edi__index_hash(const char *tag, size_t taglen, const char *qual, size_t quallen)
+{
+	unsigned long h;
+	size_t c;
+	
+	h = 2166136261UL;
+	for(c = 0; c < taglen; c++)
+	{
+		h = ((h ^ (unsigned char) tag[c]) * 16777619UL) & 0xffffffffUL;
+	}
+	if(NULL != qual)
+	{
+		h = ((h ^ 0xff) * 16777619UL) & 0xffffffffUL;
+		for(c = 0; c < quallen; c++)
+		{
+			h = ((h ^ (unsigned char) qual[c]) * 16777619UL) & 0xffffffffUL;
+		}
+	}
+	return h;
+}
+
+/* Return the entry of @table (of @alloc entries) matching the key, or the
+ * unused entry where it would be added.
+ */
+static edi_indexent_t *
+edi__index_slot(edi_indexent_t *table, size_t alloc, const char *tag, size_t taglen, const char *qual, size_t quallen, unsigned long hash)
+{
+	edi_indexent_t *e;
+	size_t c;
+	
+	for(c = hash & (alloc - 1); NULL != (e = &(table[c]))->tag; c = (c + 1) & (alloc - 1))
+	{
+		if(e->hash != hash || e->taglen != taglen || memcmp(e->tag, tag, taglen))
+		{
+			continue;
+		}
+		if(NULL == qual && NULL == e->qual)
+		{
+			return e;
+		}
+		if(NULL != qual && NULL != e->qual && e->quallen == quallen && !memcmp(e->qual, qual, quallen))
+		{
+			return e;
+		}
+	}
+	return e;
+}
+
+/* Grow the hash table of @msg to @n entries, re-inserting those in use */
+static int
+edi__index_grow(edi_interchange_t *msg, size_t n)
+{
+	edi_interchange_private_t *priv;
+	edi_indexent_t *table, *e;
+	size_t c;
+	
+	priv = msg->private_;
+	if(NULL == (table = (edi_indexent_t *) calloc(n, sizeof(edi_indexent_t))))
+	{
+		return -1;
+	}
+	for(c = 0; c < priv->indexalloc; c++)
+	{
+		if(NULL != priv->index[c].tag)
+		{
+			e = &(priv->index[c]);
+			*edi__index_slot(table, n, e->tag, e->taglen, e->qual, e->quallen, e->hash) = *e;
+		}
+	}
+	free(priv->index);
+	priv->index = table;
+	priv->indexalloc = n;
+	return 0;
+}
+
+/* Add segment @segno of @msg to the index entry for the given key */
+static int
+edi__index_add(edi_interchange_t *msg, const char *tag, size_t taglen, const char *qual, size_t quallen, size_t segno)
+{
+	edi_interchange_private_t *priv;
+	edi_indexent_t *e;
+	unsigned long hash;
+	size_t *p, n;
+	
+	priv = msg->private_;
+	/* Keep the table at most half full */
+	if((priv->nindex + 1) * 2 > priv->indexalloc)
+	{
+		if(-1 == edi__index_grow(msg, priv->indexalloc ? priv->indexalloc * 2 : INDEX_BLOCKSIZE))
+		{
+			return -1;
+		}
+	}
+	hash = edi__index_hash(tag, taglen, qual, quallen);
+	e = edi__index_slot(priv->index, priv->indexalloc, tag, taglen, qual, quallen, hash);
+	if(e->nsegs + 1 > e->segalloc)
+	{
+		n = (e->segalloc ? e->segalloc * 2 : 4);
+		if(NULL == (p = (size_t *) realloc(e->segs, sizeof(size_t) * n)))
+		{
+			return -1;
+		}
+		e->segs = p;
+		e->segalloc = n;
+	}
+	if(NULL == e->tag)
+	{
+		e->tag = tag;
+		e->taglen = taglen;
+		e->qual = qual;
+		e->quallen = quallen;
+		e->hash = hash;
+		priv->nindex++;
+	}
+	e->segs[e->nsegs] = segno;
+	e->nsegs++;
+	return 0;
+}
+
+/* Discard the index of @msg */
+void
+edi__index_destroy(edi_interchange_t *msg)
+{
+	edi_interchange_private_t *priv;
+	size_t c;
+	
+	priv = msg->private_;
+	for(c = 0; c < priv->indexalloc; c++)
+	{
+		free(priv->index[c].segs);
+	}
+	free(priv->index);
+	priv->index = NULL;
+	priv->indexalloc = 0;
+	priv->nindex = 0;
+	priv->nindexed = 0;
+	priv->indexstale = 0;
+}
+
+/* Bring the index of @msg up to date, adding any segments appended since
+ * it was last updated, or rebuilding it if an indexed segment has been
+ * modified. Returns 0 on success, -1 on failure.
+ */
+int
+edi__index_update(edi_interchange_t *msg)
+{
+	edi_interchange_private_t *priv;
+	const edi_segment_t *seg;
+	const edi_element_t *el;
+	const char *qual;
+	size_t c, quallen;
+	
+	priv = msg->private_;
+	if(priv->indexstale)
+	{
+		edi__index_destroy(msg);
+	}
+	for(c = priv->nindexed; c < msg->nsegments; c++)
+	{
+		seg = &(msg->segments[c]);
+		if(NULL == seg->tag)
+		{
+			continue;
+		}
+		qual = NULL;
+		quallen = 0;
+		if(seg->nelements > 1)
+		{
+			el = &(seg->elements[1]);
+			if(EDI_ELEMENT_SIMPLE == el->type)
+			{
+				qual = el->simple.value;
+				quallen = el->simple.valuelen;
+			}
+			else if(el->composite.nvalues)
+			{
+				qual = el->composite.values[0];
+				quallen = el->composite.valuelens[0];
+			}
+			else
+			{
+				qual = "";
+			}
+			if(NULL == qual)
+			{
+				qual = "";
+			}
+		}
+		if(-1 == edi__index_add(msg, seg->tag, strlen(seg->tag), NULL, 0, c) ||
+			(NULL != qual && -1 == edi__index_add(msg, seg->tag, strlen(seg->tag), qual, quallen, c)))
+		{
+			/* Start afresh next time */
+			priv->indexstale = 1;
+			return -1;
+		}
+	}
+	priv->nindexed = c;
+	return 0;
+}
+
+size_t
+edi_interchange_find(edi_interchange_t *msg, const char *tag, const char *qualifier, const size_t **indices)
+{
+	edi_interchange_private_t *priv;
+	edi_indexent_t *e;
+	size_t taglen, quallen;
+	
+	*indices = NULL;
+	if(-1 == edi__index_update(msg))
+	{
+		return (size_t) -1;
+	}
+	priv = msg->private_;
+	if(NULL == tag || !priv->indexalloc)
+	{
+		return 0;
+	}
+	taglen = strlen(tag);
+	quallen = (NULL == qualifier ? 0 : strlen(qualifier));
+	e = edi__index_slot(priv->index, priv->indexalloc, tag, taglen, qualifier, quallen, edi__index_hash(tag, taglen, qualifier, quallen));
+	if(NULL == e->tag)
+	{
+		return 0;
+	}
+	*indices = e->segs;
+	return e->nsegs;
+}
+
+edi_segment_t *
+edi_interchange_find_segment(edi_interchange_t *msg, const char *tag, const char *qualifier)
+{
+	const size_t *indices;
+	size_t n;
+	
+	n = edi_interchange_find(msg, tag, qualifier, &indices);
+	if(!n || (size_t) -1 == n)
+	{
+		return NULL;
+	}
+	return &(msg->segments[indices[0]]);
+}
@@ -33,28 +33,31 @@
 
 #include "p_libedi.h"
 
-static int edi__init_complete;
+static int edi__init_result;
 
 #ifdef LIBEDI_USE_PTHREAD
-static pthread_mutex_t edi__init_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t edi__init_once = PTHREAD_ONCE_INIT;
+#else
+static int edi__init_complete;
 #endif
 
+static void
+edi__init_run(void)
+{
+	edi__init_result = edi__detect_init();
+}
+
 int
 edi__init(void)
 {
-	int r;
-	
-	r = 0;
 #ifdef LIBEDI_USE_PTHREAD
-	pthread_mutex_lock(&edi__init_lock);
-#endif
+	pthread_once(&edi__init_once, edi__init_run);
+#else
 	if(0 == edi__init_complete)
 	{
-		r = edi__detect_init();
+		edi__init_complete = 1;
+		edi__init_run();
 	}
-	edi__init_complete = 1;
-#ifdef LIBEDI_USE_PTHREAD
-	pthread_mutex_unlock(&edi__init_lock);
 #endif
-	return r;
+	return edi__init_result;
 }
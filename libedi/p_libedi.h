@@ -33,6 +33,7 @@
 # include <stdio.h>
 # include <stdlib.h>
 # include <string.h>
+# include <time.h>
 # ifdef HAVE_PTHREAD_H
 #  include <pthread.h>
 # endif
@@ -44,9 +45,54 @@
 
 # include "libedi.h"
 
+typedef struct edi_binseg_struct edi_binseg_t;
+typedef struct edi_limits_struct edi_limits_t;
+typedef struct edi_container_struct edi_container_t;
+typedef struct edi_parsestate_struct edi_parsestate_t;
+typedef struct edi_emitter_struct edi_emitter_t;
+typedef struct edi_sink_struct edi_sink_t;
+typedef struct edi_buildlevel_struct edi_buildlevel_t;
+typedef struct edi_seginfo_struct edi_seginfo_t;
+typedef struct edi_indexent_struct edi_indexent_t;
+typedef struct edi_querypred_struct edi_querypred_t;
+typedef struct edi_queryterm_struct edi_queryterm_t;
+
+# define CONTAINER_MAX                 8
+# define READER_DEPTH                  16
+# define READER_DETECT_MIN             128
+# define BUILDER_DEPTH                 16
+# define BINARY_MAX                    8
+# define QUERY_PREDMAX                 4
+
+/* A segment which carries a length-prefixed binary payload */
+struct edi_binseg_struct
+{
+	char tag[8];
+	size_t element; /* Index of the element holding the payload length */
+};
+
+/* A container, delimited by start and end segments */
+struct edi_container_struct
+{
+	char start[8];
+	char end[8];
+	size_t ref; /* Element of the start segment holding the control reference, or 0 */
+	unsigned long startcode; /* Packed tags, or EDI_TAG_NONE if too long */
+	unsigned long endcode;
+};
+
+/* Parsing limits (see edi_params_t); zero means unlimited */
+struct edi_limits_struct
+{
+	size_t segments;
+	size_t elements;
+	size_t components;
+	size_t valuelen;
+	size_t memory;
+};
+
 struct edi_parser_struct
 {
-	int error; /* Error status */
 	int sep_seg; /* Segment separator */
 	int sep_data; /* Data element separator */
 	int sep_sub; /* Sub-element separator */
@@ -54,6 +100,219 @@ struct edi_parser_struct
 	int escape; /* Escape (release) character */
 	int detect; /* If 1, allow auto-detection */
 	char *root; /* Root element to use by default */
+	unsigned char skip[256]; /* Non-zero for characters to skip between segments */
+	edi_binseg_t binary[BINARY_MAX]; /* Binary segments */
+	size_t nbinary;
+	edi_limits_t limits;
+	edi_container_t containers[CONTAINER_MAX]; /* Container segments */
+	size_t ncontainers;
+	int index; /* If 1, index interchanges as they are parsed */
+};
+
+/* Serializer state derived from a parameter set */
+struct edi_emitter_struct
+{
+	const edi_params_t *params;
+	const char *hdrname; /* Service string advice header, if any */
+	const char *hdrtrail;
+	const char *newline; /* Written after each segment, if not NULL */
+	edi_binseg_t binary[BINARY_MAX]; /* Binary segments */
+	size_t nbinary;
+	unsigned char sep_seg; /* Separators, copied from params */
+	unsigned char sep_data;
+	unsigned char sep_sub;
+	unsigned char sep_tag;
+	unsigned char escape;
+	unsigned char specials[5]; /* Octets which must be escaped */
+	unsigned char special[256]; /* Non-zero for octets which must be escaped */
+};
+
+/* Destination for serialized output. Octets beyond @buflen (or all of them,
+ * if @buf is NULL) are counted in @pos but not stored.
+ */
+struct edi_sink_struct
+{
+	unsigned char *buf;
+	size_t buflen;
+	size_t pos;
+	edi_iov_t *iov; /* If not NULL, output is collected here instead */
+};
+
+# ifdef EDI_HAVE_IOV
+/* Output collected as a vector of references to values and to a scratch
+ * area holding separators and escaped values.
+ */
+struct edi_iov_struct
+{
+	struct iovec *vec;
+	size_t *scratchoff; /* Offset of each entry within scratch, or (size_t) -1 */
+	size_t nvec;
+	size_t vecalloc;
+	char *scratch;
+	size_t scratchlen;
+	size_t scratchalloc;
+	int error;
+};
+# endif
+
+/* A serializer producing output in pieces */
+struct edi_writer_struct
+{
+	edi_interchange_t *msg;
+	edi_emitter_t em;
+	size_t segment; /* Index of the next segment to stage */
+	unsigned char *buf; /* The staged segment */
+	size_t bufalloc;
+	size_t buflen;
+	size_t bufpos; /* Octets of the staged segment already returned */
+	int error;
+};
+
+/* A container open within a streaming builder */
+struct edi_buildlevel_struct
+{
+	size_t container; /* Index into the builder's containers */
+	size_t nsegments; /* Segments written, including the start segment */
+	size_t nchildren; /* Containers directly within this one */
+	char *ref; /* Control reference from the start segment, if any */
+};
+
+/* A streaming builder */
+struct edi_builder_struct
+{
+	edi_emitter_t em;
+	edi_container_t containers[CONTAINER_MAX];
+	size_t ncontainers;
+	edi_buildlevel_t stack[BUILDER_DEPTH]; /* Open containers */
+	size_t depth;
+	edi_interchange_t *interchange; /* Holds the segment being built */
+	edi_interchange_t *trailer; /* Holds automatically-generated end segments */
+	size_t nsegments; /* Segments written */
+	edi_builder_cb cb;
+	void *data;
+	int fd;
+	unsigned char *buf; /* Output not yet passed to cb */
+	size_t buflen;
+	size_t bufalloc;
+	int error;
+	size_t noctets; /* Octets written */
+	size_t segstart; /* Value of nsegments when the current interchange began */
+	edi_parser_t parser; /* Parses pre-serialized messages */
+	const edi_interchange_t *envelope; /* Start segments of each batch */
+	unsigned long seq; /* Control reference of the next batch */
+	size_t maxmessages; /* Batch limits; zero if unlimited */
+	size_t maxoctets;
+	unsigned long maxage;
+	int inbatch; /* Non-zero while a batch is open */
+	size_t envdepth; /* Containers opened by the envelope */
+	size_t nmessages; /* Messages in the current batch */
+	size_t batchoctets; /* Value of noctets when the current batch began */
+	time_t opened; /* When the current batch began */
+};
+
+/* A streaming separator transcoder */
+struct edi_transcoder_struct
+{
+	const edi_parser_t *oparser; /* The parser supplied by the caller */
+	edi_parser_t parser; /* The parser in use, following detection */
+	int detected; /* Non-zero once auto-detection has been performed */
+	edi_emitter_t src; /* Source separators, for scanning */
+	edi_emitter_t em; /* Target parameters */
+	size_t nsegments; /* Segments written */
+	edi_builder_cb cb;
+	void *data;
+	char *in; /* Data which does not yet form a complete segment */
+	size_t inlen;
+	size_t inalloc;
+	size_t retry; /* Amount of data to buffer before trying again */
+	unsigned char *buf; /* Output not yet passed to cb */
+	size_t buflen;
+	size_t bufalloc;
+	int error; /* Once set, all further calls fail with this */
+};
+
+/* A condition on the value at a position within a segment */
+struct edi_querypred_struct
+{
+	size_t element;
+	size_t component; /* Counted from 0 */
+	char *value;
+	size_t len;
+};
+
+/* A compiled path expression */
+struct edi_queryterm_struct
+{
+	char *tag;
+	unsigned long tagcode;
+	edi_querypred_t preds[QUERY_PREDMAX];
+	size_t npreds;
+	size_t element; /* Position of the value selected */
+	size_t component; /* Counted from 0 */
+	size_t slot; /* Index of the path, and of its result */
+	const char *key; /* Qualifier required by a predicate, or NULL */
+	size_t keylen;
+};
+
+/* A set of path expressions, ordered by tag and then by qualifier (those
+ * without one first), so that those applying to a segment can be found by
+ * binary search.
+ */
+struct edi_query_struct
+{
+	edi_queryterm_t *terms;
+	size_t nterms;
+};
+
+/* State carried between calls to edi__parse_segment() */
+struct edi_parsestate_struct
+{
+	size_t nsegments; /* Number of segments parsed */
+	size_t mem; /* Octets of memory accounted to the interchange */
+};
+
+/* A streaming parser */
+struct edi_reader_struct
+{
+	const edi_parser_t *oparser; /* The parser supplied by the caller */
+	edi_parser_t parser; /* The parser in use, following detection */
+	int detected; /* Non-zero once auto-detection has been performed */
+	char dialect[32]; /* Name of the detected parameters, if any */
+	edi_interchange_t *interchange; /* Holds the current segment */
+	edi_parsestate_t state;
+	char *buf; /* Data which does not yet form a complete segment */
+	size_t buflen;
+	size_t bufalloc;
+	size_t retry; /* Amount of data to buffer before trying again */
+	off_t offset; /* Stream offset of the next segment */
+	size_t stack[READER_DEPTH]; /* Open containers (indices into parser.containers) */
+	size_t depth;
+	int error; /* Once set, all further calls fail with this */
+};
+
+/* Per-segment details held privately by an interchange */
+struct edi_seginfo_struct
+{
+	size_t elalloc; /* Number of elements allocated */
+	const char *src; /* The octets the segment was parsed from, or NULL if it was not parsed or has been modified since */
+	size_t srclen;
+	size_t group; /* Index of the innermost container holding the segment, plus one, or 0 */
+};
+
+/* An entry in the segment index of an interchange, keyed on a tag alone or
+ * on a tag and qualifier. The key refers to the values of the first segment
+ * added to the entry.
+ */
+struct edi_indexent_struct
+{
+	const char *tag; /* NULL if the entry is unused */
+	size_t taglen;
+	const char *qual; /* NULL if keyed on the tag alone */
+	size_t quallen;
+	unsigned long hash;
+	size_t *segs; /* Indices of the matching segments */
+	size_t nsegs;
+	size_t segalloc;
 };
 
 struct edi_interchange_private_struct
@@ -62,6 +321,22 @@ struct edi_interchange_private_struct
 	char **sp;
 	size_t *poolsize;
 	size_t npools;
+	size_t segalloc; /* Number of segments allocated */
+	edi_seginfo_t *info; /* Details of each segment */
+	int splice; /* Non-zero if unmodified segments may be copied from their source */
+	unsigned char srcsep[5]; /* Separators and escape of the source */
+	edi_indexent_t *index; /* Open-addressed hash table of segments */
+	size_t indexalloc; /* Number of entries (a power of two), or 0 */
+	size_t nindex; /* Number of entries in use */
+	size_t nindexed; /* Number of segments added to the index */
+	int indexstale; /* Non-zero if an indexed segment has been modified */
+	edi_group_t *groups; /* Containers, in the order in which they start */
+	size_t *groupparent; /* Index of each container's parent, plus one, or 0 */
+	size_t ngroups;
+	size_t groupalloc;
+	size_t groupcur; /* Innermost container open while parsing, plus one, or 0 */
+	const edi_group_t **grouplinks; /* Containers by kind, then children of each */
+	size_t kindstart[CONTAINER_MAX + 1]; /* Offset of each kind within grouplinks */
 };
 
 struct edi_regparams_struct
@@ -69,13 +344,21 @@ struct edi_regparams_struct
 	char name[32];
 	edi_params_t params;
 	size_t ndetectors;
-	size_t nalloc;
 	edi_detector_t *detectors;
 };
 
 # define STRINGPOOL_BLOCKSIZE          512
 # define SEG_BLOCKSIZE                 8
 # define ELEMENT_BLOCKSIZE             8
+# define COMPONENT_BLOCKSIZE           4
+# define WRITER_BLOCKSIZE              256
+# define BUILDER_BUFSIZE               8192
+# define IOV_MINREF                    32
+# define PARALLEL_MINSEGMENTS          1024
+# define TRANSCODER_TAGMAX             64
+# define INDEX_BLOCKSIZE               64
+# define GROUP_BLOCKSIZE               16
+# define COLUMN_BLOCKSIZE              256
 
 extern const edi_params_t edi__default_params;
 
@@ -83,10 +366,41 @@ int edi__init(void);
 
 ssize_t edi__stringpool_get(edi_interchange_t *msg, size_t minsize);
 char *edi__stringpool_alloc(edi_interchange_t *msg, size_t length);
-int edi__stringpool_free(edi_interchange_t *msg, char *p);
+void edi__stringpool_reset(edi_interchange_t *msg);
 int edi__stringpool_destroy(edi_interchange_t *msg);
 
 int edi__detect_init(void);
-int edi__detect(edi_parser_t *parser, const char *message, edi_params_t *params, size_t *skip);
+int edi__detect(const edi_parser_t *parser, const char *message, size_t len, edi_params_t *params, size_t *skip, const edi_regparams_t **rp);
+
+int edi__parser_init(edi_parser_t *parser, const edi_params_t *params);
+int edi__parser_detect(const edi_parser_t *oparser, const char *message, size_t len, edi_parser_t *dest, size_t *skip, const edi_regparams_t **rp);
+int edi__parse_segment(const edi_parser_t *parser, edi_interchange_t *p, edi_parsestate_t *state, const char **message, const char *end);
+int edi__container_compile(const char *spec, edi_container_t *dest, size_t max);
+void edi__interchange_reset(edi_interchange_t *msg);
+int edi__interchange_grow(edi_interchange_t *msg, size_t n);
+int edi__segment_grow(edi_segment_t *seg, size_t n);
+unsigned long edi__tag_code(const char *tag, size_t len);
+
+int edi__emitter_init(edi_emitter_t *em, const edi_params_t *params);
+void edi__emit_segment(const edi_emitter_t *em, edi_sink_t *sink, const edi_segment_t *seg, int first);
+void edi__emit_header(const edi_emitter_t *em, edi_sink_t *sink);
+void edi__emit_end(const edi_emitter_t *em, edi_sink_t *sink, int hdrtrailer);
+void edi__emit_value(const edi_emitter_t *em, edi_sink_t *sink, const char *value, size_t len, int raw);
+void edi__emit_char(edi_sink_t *sink, int ch);
+
+void edi__escape_init(edi_emitter_t *em);
+void edi__escape_specials(edi_emitter_t *em);
+size_t edi__escape_scan(const edi_emitter_t *em, const char *value, size_t len);
+
+int edi__group_segment(const edi_parser_t *parser, edi_interchange_t *msg);
+int edi__group_finish(edi_interchange_t *msg);
+void edi__group_destroy(edi_interchange_t *msg);
+int edi__container_match(const edi_segment_t *seg, const char *tag, unsigned long code);
+
+int edi__index_update(edi_interchange_t *msg);
+void edi__index_destroy(edi_interchange_t *msg);
+
+int edi__binary_compile(const char *spec, edi_binseg_t *dest, size_t max);
+int edi__binary_length(const char *value, size_t len, size_t *result);
 
 #endif /* !P_LIBEDI_H_ */
@@ -0,0 +1,186 @@
+/* @(#) $Id$ */
+
+/*
+ * Copyright (c) 2003, 2004, 2005, 2006, 2007, 2008 Mo McRoberts.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) of this software may not be used to endorse
+ *    or promote products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY 
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * AUTHORS OF THIS SOFTWARE BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF 
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS 
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "p_libedi.h"
+
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+
+/* Build an interchange using several threads. Each thread is given a
+ * contiguous range of segments: the threads first measure their ranges,
+ * from which the offset at which each range begins is found, and then
+ * write their ranges directly into the caller's buffer at those offsets.
+ * Because a range's output length does not depend upon where it begins,
+ * the result is identical to that of edi_interchange_build().
+ */
+
+typedef struct edi_buildrange_struct edi_buildrange_t;
+
+struct edi_buildrange_struct
+{
+	const edi_emitter_t *em;
+	const edi_interchange_t *msg;
+	size_t first; /* Index of the first segment */
+	size_t last; /* Index of the segment following the range */
+	edi_sink_t sink;
+};
+
+static void *edi__buildrange_run(void *arg);
+static void edi__buildrange_all(edi_buildrange_t *ranges, size_t nranges);
+
+size_t
+edi_interchange_build_parallel(edi_interchange_t *msg, const edi_params_t *params, char *buf, size_t buflen, unsigned int nthreads)
+{
+	edi_emitter_t em;
+	edi_buildrange_t *ranges;
+	size_t c, n, pos;
+	
+#ifdef LIBEDI_USE_PTHREAD
+	if(0 == nthreads)
+	{
+# if defined(HAVE_UNISTD_H) && defined(_SC_NPROCESSORS_ONLN)
+		long ncpu;
+		
+		ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = (ncpu > 0 ? (unsigned int) ncpu : 1);
+# else
+		nthreads = 1;
+# endif
+	}
+#else
+	nthreads = 1;
+#endif
+	/* Give each thread enough work to be worth starting */
+	n = msg->nsegments / PARALLEL_MINSEGMENTS;
+	if(n < nthreads)
+	{
+		nthreads = (n ? (unsigned int) n : 1);
+	}
+	if(1 == nthreads)
+	{
+		return edi_interchange_build(msg, params, buf, buflen);
+	}
+	if(-1 == edi__emitter_init(&em, params) ||
+		NULL == (ranges = (edi_buildrange_t *) calloc(nthreads, sizeof(edi_buildrange_t))))
+	{
+		/* Fails in the same way */
+		return edi_interchange_build(msg, params, buf, buflen);
+	}
+	for(c = 0; c < nthreads; c++)
+	{
+		ranges[c].em = &em;
+		ranges[c].msg = msg;
+		ranges[c].first = msg->nsegments * c / nthreads;
+		ranges[c].last = msg->nsegments * (c + 1) / nthreads;
+	}
+	/* Measure each range */
+	edi__buildrange_all(ranges, nthreads);
+	/* Position each range after its predecessors, and write them. A range
+	 * is limited to its own extent, so that an octet later removed by a
+	 * backspace cannot land in the next range.
+	 */
+	for(c = 0, pos = 0; c < nthreads; c++)
+	{
+		n = ranges[c].sink.pos;
+		ranges[c].sink.buf = (unsigned char *) buf;
+		ranges[c].sink.buflen = (pos + n < buflen ? pos + n : buflen);
+		ranges[c].sink.pos = pos;
+		pos += n;
+	}
+	edi__buildrange_all(ranges, nthreads);
+	free(ranges);
+	if(pos < buflen)
+	{
+		buf[pos] = 0;
+		return pos;
+	}
+	return buflen;
+}
+
+/* Emit the segments of a range to its sink */
+static void *
+edi__buildrange_run(void *arg)
+{
+	edi_buildrange_t *range;
+	size_t c;
+	
+	range = (edi_buildrange_t *) arg;
+	/* When writing, stop once the range's extent is full */
+	for(c = range->first; c < range->last && (NULL == range->sink.buf || range->sink.pos <= range->sink.buflen); c++)
+	{
+		edi__emit_segment(range->em, &(range->sink), &(range->msg->segments[c]), 0 == c);
+	}
+	return NULL;
+}
+
+/* Run every range, the first on the calling thread and the others on new
+ * threads where these can be started.
+ */
+static void
+edi__buildrange_all(edi_buildrange_t *ranges, size_t nranges)
+{
+	size_t c;
+#ifdef LIBEDI_USE_PTHREAD
+	pthread_t *threads;
+	char *started;
+	
+	threads = (pthread_t *) calloc(nranges, sizeof(pthread_t));
+	started = (char *) calloc(nranges, 1);
+	if(NULL != threads && NULL != started)
+	{
+		for(c = 1; c < nranges; c++)
+		{
+			started[c] = (0 == pthread_create(&(threads[c]), NULL, edi__buildrange_run, &(ranges[c])));
+		}
+	}
+	edi__buildrange_run(&(ranges[0]));
+	for(c = 1; c < nranges; c++)
+	{
+		if(NULL != started && started[c])
+		{
+			pthread_join(threads[c], NULL);
+		}
+		else
+		{
+			edi__buildrange_run(&(ranges[c]));
+		}
+	}
+	free(threads);
+	free(started);
+#else
+	for(c = 0; c < nranges; c++)
+	{
+		edi__buildrange_run(&(ranges[c]));
+	}
+#endif
+}
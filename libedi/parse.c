@@ -33,9 +33,13 @@
 
 #include "p_libedi.h"
 
-static int edi__parser_init(edi_parser_t *parser, const edi_params_t *params);
+static void edi__parser_seterror(const edi_parser_t *parser, int error);
+static int edi__parser_isbinary(const edi_parser_t *parser, const edi_segment_t *seg, size_t element);
 static size_t memcpyescape(char *dest, const char *src, int escape, size_t len);
 
+/* Non-zero if @n exceeds @limit, where a limit of zero is unlimited */
+#define EXCEEDS(limit, n)              ((limit) && (n) > (limit))
+
 edi_parser_t *
 edi_parser_create(const edi_params_t *params)
 {
@@ -75,209 +79,484 @@ edi_parser_destroy(edi_parser_t *parser)
 }
 
 edi_interchange_t *
-edi_parser_parse(edi_parser_t *oparser, const char *message)
+edi_parser_parse(edi_parser_t *parser, const char *message)
+{
+	return edi_parser_parse_buf(parser, message, (NULL == message ? 0 : strlen(message)));
+}
+
+edi_interchange_t *
+edi_parser_parse_buf(edi_parser_t *parser, const char *message, size_t len)
 {
-	int e;
-	const char *ts;
-	char *value, **vp;
-	size_t len, *lp;
 	edi_interchange_t *p;
-	edi_segment_t *seg, *segp;
-	edi_element_t *el, *elp;
-	size_t skip, segalloc, elalloc;
-	int newel;
-	edi_parser_t *parser, staticparser;
-	edi_params_t params;
+	int error;
+	
+	p = edi_parser_parse_r(parser, message, len, &error);
+	edi__parser_seterror(parser, error);
+	return p;
+}
+
+/* Parse a message without modifying the parser, so that a single parser may
+ * be used by any number of threads at once. The result of parsing is stored
+ * in @error.
+ */
+edi_interchange_t *
+edi_parser_parse_r(const edi_parser_t *oparser, const char *message, size_t msglen, int *error)
+{
+	int err;
+	const char *end;
+	edi_interchange_t *p;
+	size_t skip, n;
+	const edi_parser_t *parser;
+	edi_parser_t staticparser;
+	edi_parsestate_t state;
 	
 	parser = oparser;
-	if(1 == oparser->detect)
+	if(NULL == message)
 	{
-		/* Attempt auto-detection; if it succeeds, and a params
-		 * struct is returned, construct a temporary parser based upon
-		 * it and skip the necessary number of bytes.
-		 */
-		params.version = 0;
-		if(-1 == edi__detect(oparser, message, &params, &skip))
+		msglen = 0;
+	}
+	end = message + msglen;
+	if(message)
+	{
+		while(message < end && oparser->skip[(unsigned char) *message])
 		{
-			return NULL;
+			message++;
 		}
-		if(0 != params.version)
+	}
+	if(1 == oparser->detect && message)
+	{
+		/* Attempt auto-detection; if it succeeds, a temporary parser is
+		 * constructed and the necessary number of bytes skipped.
+		 */
+		switch(edi__parser_detect(oparser, message, end - message, &staticparser, &skip, NULL))
 		{
-			if(-1 == edi__parser_init(&staticparser, &params))
-			{
-				oparser->error = EDI_ERR_SYSTEM;
+			case -1:
+				*error = EDI_ERR_SYSTEM;
 				return NULL;
-			}
-			parser = &staticparser;
+			case 1:
+				parser = &staticparser;
+				message += skip;
+				break;
 		}
-		message += skip;
 	}
-	parser->error = EDI_ERR_NONE;
+	err = EDI_ERR_NONE;
 	if(NULL == (p = edi_interchange_create()))
 	{
-		parser->error = EDI_ERR_SYSTEM;
+		*error = EDI_ERR_SYSTEM;
 		return NULL;
 	}
-	segalloc = 0;
-	if(!message || !*message)
+	memset(&state, 0, sizeof(state));
+	p->private_->srcsep[0] = (unsigned char) parser->sep_seg;
+	p->private_->srcsep[1] = (unsigned char) parser->sep_data;
+	p->private_->srcsep[2] = (unsigned char) parser->sep_sub;
+	p->private_->srcsep[3] = (unsigned char) parser->sep_tag;
+	p->private_->srcsep[4] = (unsigned char) parser->escape;
+	if(!message || message >= end)
 	{
-		parser->error = EDI_ERR_EMPTY;
+		*error = EDI_ERR_EMPTY;
 		return p;
 	}
 	/* We know that the buffer required to hold the values resulting from 
 	 * parsing won't exceed the size of the message in the first place,
-	 * so create a stringpool of that size first.
+	 * so create a stringpool of that size first (or of the memory limit,
+	 * if smaller, as parsing will stop before that is exhausted).
 	 */
-	edi__stringpool_get(p, strlen(message) + 1);
-	while(message && *message)
+	n = end - message + 1;
+	if(parser->limits.memory && n > parser->limits.memory)
+	{
+		n = parser->limits.memory;
+	}
+	if(-1 == edi__stringpool_get(p, n))
 	{
-		if(p->nsegments + 1 > segalloc)
+		*error = EDI_ERR_SYSTEM;
+		return p;
+	}
+	while(message < end)
+	{
+		while(message < end && parser->skip[(unsigned char) *message])
 		{
-			segp = (edi_segment_t *) realloc(p->segments, sizeof(edi_segment_t) * (segalloc + SEG_BLOCKSIZE));
-			if(NULL == segp)
-			{
-				parser->error = EDI_ERR_SYSTEM;
-				message = NULL;
-				break;
-			}
-			p->segments = segp;
-			segalloc += 8;
-		}
-		seg = &(p->segments[p->nsegments]);
-		p->nsegments++;
-		memset(seg, 0, sizeof(edi_segment_t));
-		seg->interchange = p;
-		elalloc = 0;
-		newel = 1;
-		el = NULL;
-		/* Loop the data elements */
-		while(*message && *message != parser->sep_seg)
-		{
-			if(newel)
+			message++;
+		}
+		if(message >= end)
+		{
+			break;
+		}
+		if(EDI_ERR_NONE != (err = edi__parse_segment(parser, p, &state, &message, end)))
+		{
+			break;
+		}
+		if(parser->ncontainers && -1 == edi__group_segment(parser, p))
+		{
+			err = EDI_ERR_SYSTEM;
+			break;
+		}
+	}
+	if(-1 == edi__group_finish(p) && EDI_ERR_NONE == err)
+	{
+		err = EDI_ERR_SYSTEM;
+	}
+	if(parser->index && -1 == edi__index_update(p) && EDI_ERR_NONE == err)
+	{
+		err = EDI_ERR_SYSTEM;
+	}
+	*error = err;
+	return p;
+}
+
+/* Attempt auto-detection of the interchange at @message using the registry;
+ * if it succeeds, initialise @dest for the detected flavour, set @skip to the
+ * number of header bytes to skip and return 1. If @rp is not NULL, it
+ * receives the matching registered parameters. Returns 0 if nothing matched.
+ */
+int
+edi__parser_detect(const edi_parser_t *oparser, const char *message, size_t len, edi_parser_t *dest, size_t *skip, const edi_regparams_t **rp)
+{
+	edi_params_t params;
+	
+	params.version = 0;
+	*skip = 0;
+	if(-1 == edi__detect(oparser, message, len, &params, skip, rp))
+	{
+		return -1;
+	}
+	if(0 == params.version)
+	{
+		return 0;
+	}
+	if(-1 == edi__parser_init(dest, &params))
+	{
+		return -1;
+	}
+	/* Inter-segment whitespace, limits and indexing are properties of the
+	 * parser, not of the detected flavour.
+	 */
+	memcpy(dest->skip, oparser->skip, sizeof(dest->skip));
+	dest->limits = oparser->limits;
+	dest->index = oparser->index;
+	return 1;
+}
+
+/* Parse a single segment at *@message (which must not be inter-segment
+ * whitespace), appending it to @p and advancing *@message past its segment
+ * separator. Returns one of EDI_ERR_xxx; in the case of EDI_ERR_UNTERMINATED,
+ * the partial segment is left in place and *@message is set to @end.
+ */
+int
+edi__parse_segment(const edi_parser_t *parser, edi_interchange_t *p, edi_parsestate_t *state, const char **msgp, const char *end)
+{
+	int e, bin, newel;
+	const char *ts, *message;
+	char *value, **vp;
+	size_t len, *lp;
+	edi_segment_t *seg;
+	edi_element_t *el;
+	edi_seginfo_t *info;
+	size_t compalloc, binlen, vlen, n;
+	
+	message = *msgp;
+	if(EXCEEDS(parser->limits.segments, state->nsegments + 1))
+	{
+		return EDI_ERR_SEGMENTS;
+	}
+	if(p->nsegments + 1 > p->private_->segalloc)
+	{
+		/* Grow geometrically, so that the cost of copying is linear
+		 * in the number of segments.
+		 */
+		n = (p->private_->segalloc ? p->private_->segalloc * 2 : SEG_BLOCKSIZE);
+		if(EXCEEDS(parser->limits.memory, state->mem + sizeof(edi_segment_t) * (n - p->private_->segalloc)))
+		{
+			return EDI_ERR_MEMORY;
+		}
+		state->mem += sizeof(edi_segment_t) * (n - p->private_->segalloc);
+		if(-1 == edi__interchange_grow(p, n))
+		{
+			return EDI_ERR_SYSTEM;
+		}
+	}
+	seg = &(p->segments[p->nsegments]);
+	p->nsegments++;
+	state->nsegments++;
+	memset(seg, 0, sizeof(edi_segment_t));
+	seg->interchange = p;
+	info = &(p->private_->info[p->nsegments - 1]);
+	info->elalloc = 0;
+	info->src = NULL;
+	info->group = 0;
+	compalloc = 0;
+	newel = 1;
+	el = NULL;
+	bin = 0;
+	binlen = 0;
+	/* Loop the data elements; a binary payload may begin with (or
+	 * consist entirely of) a segment separator.
+	 */
+	while(message < end && (bin || *message != parser->sep_seg))
+	{
+		if(newel)
+		{
+			if(EXCEEDS(parser->limits.elements, seg->nelements + 1))
 			{
-				if(seg->nelements + 1 > elalloc)
-				{
-					elp = (edi_element_t *) realloc(seg->elements, sizeof(edi_element_t) * (elalloc + ELEMENT_BLOCKSIZE));
-					if(NULL == elp)
-					{
-						parser->error = EDI_ERR_SYSTEM;
-						message = NULL;
-						break;
-					}
-					seg->elements = elp;
-					elalloc += 8;
-				}
-				el = &(seg->elements[seg->nelements]);
-				seg->nelements++;
-				memset(el, 0, sizeof(edi_element_t));
-				el->simple.segment = seg;
-				newel = 0;
+				return EDI_ERR_ELEMENTS;
 			}
-			ts = message;
-			e = 0;
-			while(*message)
+			if(seg->nelements + 1 > info->elalloc)
 			{
-				if(e)
-				{
-					message++;
-					e = 0;
-					continue;
-				}
-				if(parser->escape && *message == parser->escape)
+				n = (info->elalloc ? info->elalloc * 2 : ELEMENT_BLOCKSIZE);
+				if(EXCEEDS(parser->limits.memory, state->mem + sizeof(edi_element_t) * (n - info->elalloc)))
 				{
-					e = 1;
-					message++;
-					continue;
+					return EDI_ERR_MEMORY;
 				}
-				if(*message == parser->sep_sub || 
-					(seg->elements != el && *message == parser->sep_data) ||
-					(seg->elements == el && *message == parser->sep_tag) ||
-					*message == parser->sep_seg)
+				state->mem += sizeof(edi_element_t) * (n - info->elalloc);
+				if(-1 == edi__segment_grow(seg, n))
 				{
-					break;
+					return EDI_ERR_SYSTEM;
 				}
+			}
+			el = &(seg->elements[seg->nelements]);
+			seg->nelements++;
+			memset(el, 0, sizeof(edi_element_t));
+			el->simple.segment = seg;
+			compalloc = 0;
+			newel = 0;
+		}
+		if(bin)
+		{
+			/* The payload is not scanned or copied: the element
+			 * refers directly to the source buffer.
+			 */
+			if(EXCEEDS(parser->limits.valuelen, binlen))
+			{
+				return EDI_ERR_VALUELEN;
+			}
+			if((size_t) (end - message) < binlen)
+			{
+				*msgp = end;
+				return EDI_ERR_UNTERMINATED;
+			}
+			el->type = EDI_ELEMENT_SIMPLE;
+			el->simple.value = (char *) message;
+			el->simple.valuelen = binlen;
+			message += binlen;
+			bin = 0;
+			if(message >= end || *message == parser->sep_seg)
+			{
+				break;
+			}
+			if(*message != parser->sep_data)
+			{
+				return EDI_ERR_BINARY;
+			}
+			newel = 1;
+			message++;
+			continue;
+		}
+		ts = message;
+		e = 0;
+		vlen = 0;
+		while(message < end && !EXCEEDS(parser->limits.valuelen, vlen))
+		{
+			if(e)
+			{
 				message++;
+				vlen++;
+				e = 0;
+				continue;
+			}
+			if(parser->escape && *message == parser->escape)
+			{
+				e = 1;
+				message++;
+				continue;
+			}
+			if(*message == parser->sep_sub || 
+				(seg->elements != el && *message == parser->sep_data) ||
+				(seg->elements == el && *message == parser->sep_tag) ||
+				*message == parser->sep_seg)
+			{
+				break;
+			}
+			message++;
+			vlen++;
+		}
+		if(EXCEEDS(parser->limits.valuelen, vlen))
+		{
+			return EDI_ERR_VALUELEN;
+		}
+		if(EXCEEDS(parser->limits.memory, state->mem + vlen + 1))
+		{
+			return EDI_ERR_MEMORY;
+		}
+		state->mem += vlen + 1;
+		if(NULL == (value = edi__stringpool_alloc(p, vlen + 1)))
+		{
+			return EDI_ERR_SYSTEM;
+		}
+		len = memcpyescape(value, ts, parser->escape, message - ts);
+		value[len] = 0;
+		if(el->type == EDI_ELEMENT_COMPOSITE || (message < end && *message == parser->sep_sub))
+		{
+			el->type = EDI_ELEMENT_COMPOSITE;
+			if(EXCEEDS(parser->limits.components, el->composite.nvalues + 1))
+			{
+				return EDI_ERR_COMPONENTS;
 			}
-			value = edi__stringpool_alloc(p, message - ts + 1);
-			len = memcpyescape(value, ts, parser->escape, message - ts);
-			value[len] = 0;
-			if(el->type == EDI_ELEMENT_COMPOSITE || *message == parser->sep_sub)
+			/* Room for the value and the terminating NULL */
+			if(el->composite.nvalues + 2 > compalloc)
 			{
-				el->type = EDI_ELEMENT_COMPOSITE;
-				vp = (char **) realloc(el->composite.values, sizeof(char *) * (el->composite.nvalues + 2));
+				n = (compalloc ? compalloc * 2 : COMPONENT_BLOCKSIZE);
+				if(EXCEEDS(parser->limits.memory, state->mem + (sizeof(char *) + sizeof(size_t)) * (n - compalloc)))
+				{
+					return EDI_ERR_MEMORY;
+				}
+				vp = (char **) realloc(el->composite.values, sizeof(char *) * n);
 				if(NULL == vp)
 				{
-					parser->error = EDI_ERR_SYSTEM;
-					message = NULL;
-					break;
+					return EDI_ERR_SYSTEM;
 				}
 				el->composite.values = vp;
-				lp = (size_t *) realloc(el->composite.valuelens, sizeof(size_t) * (el->composite.nvalues + 2));
+				lp = (size_t *) realloc(el->composite.valuelens, sizeof(size_t) * n);
 				if(NULL == lp)
 				{
-					parser->error = EDI_ERR_SYSTEM;
-					message = NULL;
-					break;
+					return EDI_ERR_SYSTEM;
 				}
 				el->composite.valuelens = lp;
-				vp[el->composite.nvalues] = value;
-				lp[el->composite.nvalues] = len;
-				el->composite.nvalues++;
-				vp[el->composite.nvalues] = NULL;
-				lp[el->composite.nvalues] = 0;
-				if(el == seg->elements && el->composite.nvalues == 1)
-				{
-					seg->tag = value;
-				}
+				state->mem += (sizeof(char *) + sizeof(size_t)) * (n - compalloc);
+				compalloc = n;
 			}
-			else
+			vp = el->composite.values;
+			lp = el->composite.valuelens;
+			vp[el->composite.nvalues] = value;
+			lp[el->composite.nvalues] = len;
+			el->composite.nvalues++;
+			vp[el->composite.nvalues] = NULL;
+			lp[el->composite.nvalues] = 0;
+			if(el == seg->elements && el->composite.nvalues == 1)
 			{
-				el->type = EDI_ELEMENT_SIMPLE;
-				el->simple.value = value;
-				el->simple.valuelen = len;
-				if(el == seg->elements)
-				{
-					seg->tag = value;
-				}
-			}
-			if(!*message || *message == parser->sep_seg)
-			{
-				break;
+				seg->tag = value;
+				seg->tagcode = edi__tag_code(value, len);
 			}
-			if(*message == parser->sep_data || *message == parser->sep_tag)
+		}
+		else
+		{
+			el->type = EDI_ELEMENT_SIMPLE;
+			el->simple.value = value;
+			el->simple.valuelen = len;
+			if(el == seg->elements)
 			{
-				newel = 1;
+				seg->tag = value;
+				seg->tagcode = edi__tag_code(value, len);
 			}
-			/* Move past the tag, data element or sub-element separator */
-			message++;
 		}
-		if(NULL == message)
+		if(message >= end || *message == parser->sep_seg)
 		{
 			break;
 		}
-		if(!*message)
+		if(*message == parser->sep_data || *message == parser->sep_tag)
 		{
-			parser->error = EDI_ERR_UNTERMINATED;
-			break;
+			newel = 1;
+			if(parser->nbinary && EDI_ELEMENT_SIMPLE == el->type &&
+				edi__parser_isbinary(parser, seg, seg->nelements - 1))
+			{
+				if(-1 == edi__binary_length(el->simple.value, el->simple.valuelen, &binlen))
+				{
+					return EDI_ERR_BINARY;
+				}
+				bin = 1;
+			}
 		}
-		/* Move past the segment separator */
+		/* Move past the tag, data element or sub-element separator */
 		message++;
 	}
-	return p;
+	if(message >= end)
+	{
+		*msgp = end;
+		return EDI_ERR_UNTERMINATED;
+	}
+	/* Move past the segment separator, recording where the segment came
+	 * from in case it can be copied when building.
+	 */
+	info->src = *msgp;
+	info->srclen = message + 1 - *msgp;
+	*msgp = message + 1;
+	return EDI_ERR_NONE;
+}
+
+/* Parser objects are never modified once created, so the error from the most
+ * recent call to edi_parser_parse() or edi_parser_parse_buf() is recorded
+ * per-thread for the benefit of edi_parser_error().
+ */
+
+struct edi_parser_lasterror_struct
+{
+	const edi_parser_t *parser;
+	int error;
+};
+
+#ifdef LIBEDI_USE_PTHREAD
+static pthread_once_t edi__parser_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t edi__parser_key;
+
+static void
+edi__parser_key_init(void)
+{
+	pthread_key_create(&edi__parser_key, free);
+}
+#else
+static struct edi_parser_lasterror_struct edi__parser_lasterror;
+#endif
+
+static void
+edi__parser_seterror(const edi_parser_t *parser, int error)
+{
+	struct edi_parser_lasterror_struct *le;
+	
+#ifdef LIBEDI_USE_PTHREAD
+	pthread_once(&edi__parser_key_once, edi__parser_key_init);
+	if(NULL == (le = (struct edi_parser_lasterror_struct *) pthread_getspecific(edi__parser_key)))
+	{
+		if(NULL == (le = (struct edi_parser_lasterror_struct *) malloc(sizeof(struct edi_parser_lasterror_struct))))
+		{
+			return;
+		}
+		if(0 != pthread_setspecific(edi__parser_key, le))
+		{
+			free(le);
+			return;
+		}
+	}
+#else
+	le = &edi__parser_lasterror;
+#endif
+	le->parser = parser;
+	le->error = error;
 }
 
 int
 edi_parser_error(edi_parser_t *p)
 {
-	return p->error;
+	struct edi_parser_lasterror_struct *le;
+	
+#ifdef LIBEDI_USE_PTHREAD
+	pthread_once(&edi__parser_key_once, edi__parser_key_init);
+	le = (struct edi_parser_lasterror_struct *) pthread_getspecific(edi__parser_key);
+#else
+	le = &edi__parser_lasterror;
+#endif
+	if(NULL == le || le->parser != p)
+	{
+		return EDI_ERR_NONE;
+	}
+	return le->error;
 }
 
-static int
+int
 edi__parser_init(edi_parser_t *p, const edi_params_t *params)
 {
+	const char *s;
+	int n;
+	
 	memset(p, 0, sizeof(edi_parser_t));
 	p->detect = 1;
-	p->error = EDI_ERR_NONE;
 	if(NULL == params)
 	{
 		params = &edi__default_params;
@@ -290,6 +569,232 @@ edi__parser_init(edi_parser_t *p, const edi_params_t *params)
 		p->sep_tag = params->tag_separator;
 		p->escape = params->escape;
 	}
+	if(params->version >= 0x0102 && NULL != params->containers)
+	{
+		/* The containers list was once ignored by the parser, so one
+		 * which can't be compiled leaves the parser without containers
+		 * rather than preventing its creation.
+		 */
+		if(-1 == (n = edi__container_compile(params->containers, p->containers, CONTAINER_MAX)))
+		{
+			n = 0;
+		}
+		p->ncontainers = n;
+	}
+	if(params->version >= 0x0104 && NULL != params->segment_whitespace)
+	{
+		for(s = params->segment_whitespace; *s; s++)
+		{
+			p->skip[(unsigned char) *s] = 1;
+		}
+	}
+	if(params->version >= 0x0105 && NULL != params->binary_segments)
+	{
+		if(-1 == (n = edi__binary_compile(params->binary_segments, p->binary, BINARY_MAX)))
+		{
+			return -1;
+		}
+		p->nbinary = n;
+	}
+	if(params->version >= 0x0106)
+	{
+		p->limits.segments = params->max_segments;
+		p->limits.elements = params->max_elements;
+		p->limits.components = params->max_components;
+		p->limits.valuelen = params->max_value_length;
+		p->limits.memory = params->max_memory;
+	}
+	if(params->version >= 0x0107)
+	{
+		p->index = params->index_segments;
+	}
+	return 0;
+}
+
+/* Parse a binary segment specification (TAG:N,TAG:N,...) into @dest, which
+ * has room for @max entries. Returns the number of entries, or -1 if the
+ * specification is malformed.
+ */
+int
+edi__binary_compile(const char *spec, edi_binseg_t *dest, size_t max)
+{
+	size_t n, c;
+	
+	for(n = 0; *spec; n++)
+	{
+		if(n >= max)
+		{
+			return -1;
+		}
+		for(c = 0; *spec && ':' != *spec; spec++, c++)
+		{
+			if(c + 1 >= sizeof(dest[n].tag))
+			{
+				return -1;
+			}
+			dest[n].tag[c] = *spec;
+		}
+		dest[n].tag[c] = 0;
+		if(':' != *spec || !c)
+		{
+			return -1;
+		}
+		spec++;
+		if(*spec < '0' || *spec > '9')
+		{
+			return -1;
+		}
+		for(dest[n].element = 0; *spec >= '0' && *spec <= '9'; spec++)
+		{
+			dest[n].element = (dest[n].element * 10) + (*spec - '0');
+		}
+		if(!dest[n].element)
+		{
+			return -1;
+		}
+		if(',' == *spec)
+		{
+			spec++;
+		}
+		else if(*spec)
+		{
+			return -1;
+		}
+	}
+	return n;
+}
+
+/* Return @s advanced past any whitespace */
+static const char *
+edi__container_space(const char *s)
+{
+	while(' ' == *s || '\t' == *s || '\r' == *s || '\n' == *s)
+	{
+		s++;
+	}
+	return s;
+}
+
+/* Copy the tag at @spec, which ends at whitespace or one of @delims, into
+ * @dest (of @size octets). Returns a pointer to the octet following it, or
+ * NULL if it is empty or too long.
+ */
+static const char *
+edi__container_tag(const char *spec, const char *delims, char *dest, size_t size)
+{
+	size_t c;
+	
+	for(c = 0; *spec && NULL == strchr(delims, *spec) && ' ' != *spec && '\t' != *spec && '\r' != *spec && '\n' != *spec; spec++, c++)
+	{
+		if(c + 1 >= size)
+		{
+			return NULL;
+		}
+		dest[c] = *spec;
+	}
+	dest[c] = 0;
+	return (c ? spec : NULL);
+}
+
+/* Parse a container specification (START/END[:N],START/END[:N],...) into
+ * @dest, which has room for @max entries. Whitespace around the entries and
+ * their parts is ignored. Returns the number of entries, or -1 if the
+ * specification is malformed.
+ */
+int
+edi__container_compile(const char *spec, edi_container_t *dest, size_t max)
+{
+	size_t n;
+	
+	spec = edi__container_space(spec);
+	for(n = 0; *spec; n++)
+	{
+		if(n >= max)
+		{
+			return -1;
+		}
+		if(NULL == (spec = edi__container_tag(spec, "/,:", dest[n].start, sizeof(dest[n].start))))
+		{
+			return -1;
+		}
+		spec = edi__container_space(spec);
+		if('/' != *spec)
+		{
+			return -1;
+		}
+		spec = edi__container_space(spec + 1);
+		if(NULL == (spec = edi__container_tag(spec, "/,:", dest[n].end, sizeof(dest[n].end))))
+		{
+			return -1;
+		}
+		spec = edi__container_space(spec);
+		dest[n].startcode = edi__tag_code(dest[n].start, strlen(dest[n].start));
+		dest[n].endcode = edi__tag_code(dest[n].end, strlen(dest[n].end));
+		dest[n].ref = 0;
+		if(':' == *spec)
+		{
+			spec = edi__container_space(spec + 1);
+			if(*spec < '0' || *spec > '9')
+			{
+				return -1;
+			}
+			for(; *spec >= '0' && *spec <= '9'; spec++)
+			{
+				dest[n].ref = (dest[n].ref * 10) + (*spec - '0');
+			}
+			spec = edi__container_space(spec);
+		}
+		if(',' == *spec)
+		{
+			spec = edi__container_space(spec + 1);
+		}
+		else if(*spec)
+		{
+			return -1;
+		}
+	}
+	return n;
+}
+
+/* Return 1 if @element of @seg holds the length of a binary payload */
+static int
+edi__parser_isbinary(const edi_parser_t *parser, const edi_segment_t *seg, size_t element)
+{
+	size_t c;
+	
+	if(NULL == seg->tag)
+	{
+		return 0;
+	}
+	for(c = 0; c < parser->nbinary; c++)
+	{
+		if(element == parser->binary[c].element && 0 == strcmp(seg->tag, parser->binary[c].tag))
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Decode the decimal length of a binary payload */
+int
+edi__binary_length(const char *value, size_t len, size_t *result)
+{
+	size_t n;
+	
+	if(!len)
+	{
+		return -1;
+	}
+	for(n = 0; len; value++, len--)
+	{
+		if(*value < '0' || *value > '9' || n > (((size_t) -1) - 9) / 10)
+		{
+			return -1;
+		}
+		n = (n * 10) + (*value - '0');
+	}
+	*result = n;
 	return 0;
 }
 
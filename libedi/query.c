@@ -0,0 +1,400 @@
+/* @(#) $Id$ */
+
+/*
+ * Copyright (c) 2003, 2004, 2005, 2006, 2007, 2008 Mo McRoberts.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) of this software may not be used to endorse
+ *    or promote products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY 
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * AUTHORS OF THIS SOFTWARE BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF 
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS 
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <ctype.h>
+
+#include "p_libedi.h"
+
+/* Order tags by packed code, comparing the tags themselves only where they
+ * are too long to have one.
+ */
+static int
+edi__query_tagcmp(unsigned long acode, const char *atag, unsigned long bcode, const char *btag)
+{
+	if(acode != bcode)
+	{
+		return (acode < bcode ? -1 : 1);
+	}
+	if(EDI_TAG_NONE != acode)
+	{
+		return 0;
+	}
+	return strcmp(atag, btag);
+}
+
+/* Order qualifiers, with NULL (no qualifier) first */
+static int
+edi__query_keycmp(const char *a, size_t alen, const char *b, size_t blen)
+{
+	int r;
+	
+	if(NULL == a || NULL == b)
+	{
+		return (NULL != a) - (NULL != b);
+	}
+	if(0 != (r = memcmp(a, b, (alen < blen ? alen : blen))))
+	{
+		return r;
+	}
+	return (alen < blen ? -1 : (alen > blen));
+}
+
+static int
+edi__query_termcmp(const void *a, const void *b)
+{
+	const edi_queryterm_t *ta, *tb;
+	int r;
+	
+	ta = (const edi_queryterm_t *) a;
+	tb = (const edi_queryterm_t *) b;
+	if(0 != (r = edi__query_tagcmp(ta->tagcode, ta->tag, tb->tagcode, tb->tag)))
+	{
+		return r;
+	}
+	if(0 != (r = edi__query_keycmp(ta->key, ta->keylen, tb->key, tb->keylen)))
+	{
+		return r;
+	}
+	return (ta->slot < tb->slot ? -1 : (ta->slot > tb->slot));
+}
+
+/* Parse a decimal number at @s into *@n, returning a pointer to the octet
+ * following it, or NULL if there is none.
+ */
+static const char *
+edi__query_number(const char *s, size_t *n)
+{
+	if(!isdigit((unsigned char) *s))
+	{
+		return NULL;
+	}
+	for(*n = 0; isdigit((unsigned char) *s); s++)
+	{
+		*n = (*n * 10) + (*s - '0');
+	}
+	return s;
+}
+
+/* Parse ELEMENT[:COMPONENT] at @s, counting components from 1 */
+static const char *
+edi__query_position(const char *s, size_t *element, size_t *component)
+{
+	if(NULL == (s = edi__query_number(s, element)))
+	{
+		return NULL;
+	}
+	*component = 0;
+	if(':' == *s)
+	{
+		if(NULL == (s = edi__query_number(s + 1, component)) || !*component)
+		{
+			return NULL;
+		}
+		(*component)--;
+	}
+	return s;
+}
+
+static char *
+edi__query_strndup(const char *s, size_t len)
+{
+	char *p;
+	
+	if(NULL != (p = (char *) malloc(len + 1)))
+	{
+		memcpy(p, s, len);
+		p[len] = 0;
+	}
+	return p;
+}
+
+static void
+edi__query_term_free(edi_queryterm_t *t)
+{
+	size_t c;
+	
+	free(t->tag);
+	for(c = 0; c < t->npreds; c++)
+	{
+		free(t->preds[c].value);
+	}
+}
+
+/* Compile @path into @t. Returns 0 on success, -1 if @path is malformed or
+ * memory is exhausted.
+ */
+static int
+edi__query_parse(const char *path, edi_queryterm_t *t)
+{
+	edi_querypred_t *pr;
+	const char *s, *end, *eq;
+	size_t len;
+	
+	memset(t, 0, sizeof(edi_queryterm_t));
+	for(len = 0; isalnum((unsigned char) path[len]); len++);
+	if(!len || NULL == (t->tag = edi__query_strndup(path, len)))
+	{
+		return -1;
+	}
+	t->tagcode = edi__tag_code(t->tag, len);
+	for(s = path + len; '[' == *s; s = end + 1)
+	{
+		s++;
+		if(t->npreds >= QUERY_PREDMAX || NULL == (end = strchr(s, ']')))
+		{
+			return -1;
+		}
+		pr = &(t->preds[t->npreds]);
+		if(NULL == (eq = (const char *) memchr(s, '=', end - s)))
+		{
+			/* [VALUE] is short for [qualifier=VALUE] */
+			eq = s - 1;
+			pr->element = 1;
+		}
+		else if(9 == eq - s && 0 == strncmp(s, "qualifier", 9))
+		{
+			pr->element = 1;
+		}
+		else if(eq != edi__query_position(s, &(pr->element), &(pr->component)))
+		{
+			return -1;
+		}
+		pr->len = end - (eq + 1);
+		if(NULL == (pr->value = edi__query_strndup(eq + 1, pr->len)))
+		{
+			return -1;
+		}
+		if(NULL == t->key && 1 == pr->element && !pr->component)
+		{
+			t->key = pr->value;
+			t->keylen = pr->len;
+		}
+		t->npreds++;
+	}
+	t->element = 1;
+	if('/' == *s && NULL == (s = edi__query_position(s + 1, &(t->element), &(t->component))))
+	{
+		return -1;
+	}
+	return (*s ? -1 : 0);
+}
+
+edi_query_t *
+edi_query_compile(const char *const *paths, size_t npaths, size_t *errpath)
+{
+	edi_query_t *q;
+	size_t c;
+	
+	if(NULL == (q = (edi_query_t *) calloc(1, sizeof(edi_query_t))) ||
+		NULL == (q->terms = (edi_queryterm_t *) calloc(npaths ? npaths : 1, sizeof(edi_queryterm_t))))
+	{
+		free(q);
+		if(NULL != errpath)
+		{
+			*errpath = npaths;
+		}
+		return NULL;
+	}
+	for(c = 0; c < npaths; c++)
+	{
+		q->nterms++;
+		if(-1 == edi__query_parse(paths[c], &(q->terms[c])))
+		{
+			if(NULL != errpath)
+			{
+				*errpath = c;
+			}
+			edi_query_destroy(q);
+			return NULL;
+		}
+		q->terms[c].slot = c;
+	}
+	qsort(q->terms, q->nterms, sizeof(edi_queryterm_t), edi__query_termcmp);
+	return q;
+}
+
+int
+edi_query_destroy(edi_query_t *q)
+{
+	size_t c;
+	
+	for(c = 0; c < q->nterms; c++)
+	{
+		edi__query_term_free(&(q->terms[c]));
+	}
+	free(q->terms);
+	free(q);
+	return 0;
+}
+
+/* Locate the value at @element and @component of @seg, returning 1 if it
+ * is present.
+ */
+static int
+edi__query_value(const edi_segment_t *seg, size_t element, size_t component, const char **value, size_t *len)
+{
+	const edi_element_t *el;
+	
+	if(element >= seg->nelements)
+	{
+		return 0;
+	}
+	el = &(seg->elements[element]);
+	if(EDI_ELEMENT_SIMPLE == el->type && !component)
+	{
+		*value = el->simple.value;
+		*len = el->simple.valuelen;
+	}
+	else if(EDI_ELEMENT_COMPOSITE == el->type && component < el->composite.nvalues)
+	{
+		*value = el->composite.values[component];
+		*len = el->composite.valuelens[component];
+	}
+	else
+	{
+		return 0;
+	}
+	return (NULL != *value);
+}
+
+/* If @t matches @seg and its result is still empty, fill it and return 1 */
+static int
+edi__query_eval(const edi_queryterm_t *t, const edi_segment_t *seg, size_t segno, edi_result_t *results)
+{
+	const char *value;
+	size_t c, len;
+	
+	if(NULL != results[t->slot].value)
+	{
+		return 0;
+	}
+	for(c = 0; c < t->npreds; c++)
+	{
+		if(!edi__query_value(seg, t->preds[c].element, t->preds[c].component, &value, &len) ||
+			len != t->preds[c].len || memcmp(value, t->preds[c].value, len))
+		{
+			return 0;
+		}
+	}
+	if(!edi__query_value(seg, t->element, t->component, &value, &len))
+	{
+		return 0;
+	}
+	results[t->slot].value = value;
+	results[t->slot].len = len;
+	results[t->slot].segment = segno;
+	return 1;
+}
+
+size_t
+edi_query_segment(const edi_query_t *q, const edi_segment_t *seg, size_t segno, edi_result_t *results)
+{
+	const edi_queryterm_t *t;
+	const char *qual;
+	size_t lo, hi, mid, n, quallen;
+	
+	if(NULL == seg->tag)
+	{
+		return 0;
+	}
+	/* Find the paths for this tag */
+	for(lo = 0, hi = q->nterms; lo < hi; )
+	{
+		mid = lo + (hi - lo) / 2;
+		if(edi__query_tagcmp(q->terms[mid].tagcode, q->terms[mid].tag, seg->tagcode, seg->tag) < 0)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	n = 0;
+	/* Those which don't require a qualifier are tried in turn */
+	for(t = &(q->terms[lo]); t < q->terms + q->nterms && NULL == t->key &&
+		0 == edi__query_tagcmp(t->tagcode, t->tag, seg->tagcode, seg->tag); t++)
+	{
+		n += edi__query_eval(t, seg, segno, results);
+	}
+	/* Only look at the qualifier if there are paths which need it */
+	if(t >= q->terms + q->nterms || 0 != edi__query_tagcmp(t->tagcode, t->tag, seg->tagcode, seg->tag) ||
+		!edi__query_value(seg, 1, 0, &qual, &quallen))
+	{
+		return n;
+	}
+	/* The rest are ordered by qualifier */
+	for(lo = t - q->terms, hi = q->nterms; lo < hi; )
+	{
+		mid = lo + (hi - lo) / 2;
+		if(edi__query_tagcmp(q->terms[mid].tagcode, q->terms[mid].tag, seg->tagcode, seg->tag) < 0 ||
+			(0 == edi__query_tagcmp(q->terms[mid].tagcode, q->terms[mid].tag, seg->tagcode, seg->tag) &&
+			edi__query_keycmp(q->terms[mid].key, q->terms[mid].keylen, qual, quallen) < 0))
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	for(t = &(q->terms[lo]); t < q->terms + q->nterms && 0 == edi__query_tagcmp(t->tagcode, t->tag, seg->tagcode, seg->tag) &&
+		0 == edi__query_keycmp(t->key, t->keylen, qual, quallen); t++)
+	{
+		n += edi__query_eval(t, seg, segno, results);
+	}
+	return n;
+}
+
+size_t
+edi_query_run(const edi_query_t *q, const edi_interchange_t *msg, const edi_group_t *group, edi_result_t *results)
+{
+	size_t c, end, n;
+	
+	memset(results, 0, sizeof(edi_result_t) * q->nterms);
+	c = 0;
+	end = msg->nsegments;
+	if(NULL != group)
+	{
+		c = group->start;
+		if((size_t) -1 != group->end && group->end < end)
+		{
+			end = group->end + 1;
+		}
+	}
+	for(n = 0; c < end && n < q->nterms; c++)
+	{
+		n += edi_query_segment(q, &(msg->segments[c]), c, results);
+	}
+	return n;
+}
@@ -0,0 +1,501 @@
+/* @(#) $Id$ */
+
+/*
+ * Copyright (c) 2003, 2004, 2005, 2006, 2007, 2008 Mo McRoberts.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) of this software may not be used to endorse
+ *    or promote products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY 
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * AUTHORS OF THIS SOFTWARE BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF 
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS 
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "p_libedi.h"
+
+/* Checkpoints have the form:
+ *
+ *   1:<offset>:<segments>:<separators>:<containers>:<dialect>
+ *
+ * where <separators> is the segment, element, sub-element and tag separators
+ * and the escape character as ten hexadecimal digits, <containers> is the
+ * list of open containers as dot-separated indices into the parser's
+ * container list, and <dialect> is the name of the detected parameters
+ * (which may be empty).
+ */
+
+static int edi__reader_run(edi_reader_t *r, const char *data, size_t len, int final, edi_reader_cb cb, void *ctx, size_t *consumed);
+static int edi__reader_append(edi_reader_t *r, const char *data, size_t len);
+static void edi__reader_consume(edi_reader_t *r, size_t len);
+static void edi__reader_nest(edi_reader_t *r, const edi_segment_t *seg);
+static int edi__reader_restore(edi_reader_t *r, const char *checkpoint);
+static const char *edi__reader_number(const char *s, off_t *result);
+
+static const char hexdigits[] = "0123456789abcdef";
+
+edi_reader_t *
+edi_reader_create(const edi_parser_t *parser, const char *checkpoint)
+{
+	edi_reader_t *r;
+	
+	if(NULL == parser)
+	{
+		return NULL;
+	}
+	if(NULL == (r = (edi_reader_t *) calloc(1, sizeof(edi_reader_t))))
+	{
+		return NULL;
+	}
+	r->oparser = parser;
+	memcpy(&(r->parser), parser, sizeof(edi_parser_t));
+	r->detected = !parser->detect;
+	if(NULL == (r->interchange = edi_interchange_create()))
+	{
+		free(r);
+		return NULL;
+	}
+	if(NULL != checkpoint && -1 == edi__reader_restore(r, checkpoint))
+	{
+		edi_reader_destroy(r);
+		return NULL;
+	}
+	return r;
+}
+
+int
+edi_reader_destroy(edi_reader_t *r)
+{
+	edi_interchange_destroy(r->interchange);
+	free(r->buf);
+	free(r);
+	return 0;
+}
+
+int
+edi_reader_feed(edi_reader_t *r, const char *buf, size_t len, edi_reader_cb cb, void *data)
+{
+	size_t n;
+	int err;
+	
+	if(EDI_ERR_NONE != r->error)
+	{
+		return r->error;
+	}
+	if(0 == r->buflen)
+	{
+		/* Nothing is held over from the previous call, so parse directly
+		 * from the caller's buffer and keep only what's left.
+		 */
+		err = edi__reader_run(r, buf, len, 0, cb, data, &n);
+		if(-1 == edi__reader_append(r, buf + n, len - n))
+		{
+			return (r->error = EDI_ERR_SYSTEM);
+		}
+		return err;
+	}
+	if(-1 == edi__reader_append(r, buf, len))
+	{
+		return (r->error = EDI_ERR_SYSTEM);
+	}
+	/* Don't rescan an incomplete segment until there's a reasonable amount
+	 * more of it, so that long segments supplied in small pieces don't
+	 * take quadratic time.
+	 */
+	if(r->buflen < r->retry)
+	{
+		return EDI_ERR_NONE;
+	}
+	err = edi__reader_run(r, r->buf, r->buflen, 0, cb, data, &n);
+	edi__reader_consume(r, n);
+	return err;
+}
+
+int
+edi_reader_finish(edi_reader_t *r, edi_reader_cb cb, void *data)
+{
+	size_t n;
+	int err;
+	
+	if(EDI_ERR_NONE != r->error)
+	{
+		return r->error;
+	}
+	err = edi__reader_run(r, r->buf, r->buflen, 1, cb, data, &n);
+	edi__reader_consume(r, n);
+	return err;
+}
+
+off_t
+edi_reader_offset(const edi_reader_t *r)
+{
+	return r->offset;
+}
+
+size_t
+edi_reader_depth(const edi_reader_t *r)
+{
+	return r->depth;
+}
+
+const char *
+edi_reader_container(const edi_reader_t *r, size_t level)
+{
+	if(level >= r->depth)
+	{
+		return NULL;
+	}
+	return r->parser.containers[r->stack[level]].start;
+}
+
+size_t
+edi_reader_checkpoint(const edi_reader_t *r, char *buf, size_t buflen)
+{
+	char cp[EDI_CHECKPOINT_MAX], digits[24];
+	int sep[5];
+	size_t len, c, n, d;
+	off_t o;
+	
+	len = 0;
+	cp[len++] = '1';
+	for(c = 0; c < 2; c++)
+	{
+		cp[len++] = ':';
+		o = (0 == c ? r->offset : (off_t) r->state.nsegments);
+		n = 0;
+		do
+		{
+			digits[n++] = '0' + (int) (o % 10);
+			o /= 10;
+		}
+		while(o);
+		while(n)
+		{
+			cp[len++] = digits[--n];
+		}
+	}
+	cp[len++] = ':';
+	sep[0] = r->parser.sep_seg;
+	sep[1] = r->parser.sep_data;
+	sep[2] = r->parser.sep_sub;
+	sep[3] = r->parser.sep_tag;
+	sep[4] = r->parser.escape;
+	for(c = 0; c < 5; c++)
+	{
+		cp[len++] = hexdigits[(sep[c] >> 4) & 15];
+		cp[len++] = hexdigits[sep[c] & 15];
+	}
+	cp[len++] = ':';
+	for(c = 0; c < r->depth; c++)
+	{
+		if(c)
+		{
+			cp[len++] = '.';
+		}
+		/* Indices are always less than CONTAINER_MAX */
+		d = r->stack[c];
+		if(d >= 10)
+		{
+			cp[len++] = '0' + (int) (d / 10);
+		}
+		cp[len++] = '0' + (int) (d % 10);
+	}
+	cp[len++] = ':';
+	for(c = 0; r->dialect[c]; c++)
+	{
+		cp[len++] = r->dialect[c];
+	}
+	if(len < buflen)
+	{
+		memcpy(buf, cp, len);
+		buf[len] = 0;
+	}
+	return len;
+}
+
+/* Parse as many segments as possible from @data, setting @consumed to the
+ * number of bytes which need not be supplied again. Unless @final is set, an
+ * incomplete segment at the end of @data is not an error.
+ */
+static int
+edi__reader_run(edi_reader_t *r, const char *data, size_t len, int final, edi_reader_cb cb, void *ctx, size_t *consumed)
+{
+	const char *pos, *end, *start, *mark;
+	const edi_regparams_t *rp;
+	size_t skip;
+	int err;
+	
+	pos = data;
+	mark = data;
+	end = data + len;
+	err = EDI_ERR_NONE;
+	r->retry = 0;
+	while(1)
+	{
+		while(pos < end && r->parser.skip[(unsigned char) *pos])
+		{
+			pos++;
+		}
+		if(pos >= end)
+		{
+			break;
+		}
+		if(!r->detected)
+		{
+			if(!final && (size_t) (end - pos) < READER_DETECT_MIN)
+			{
+				r->retry = READER_DETECT_MIN;
+				break;
+			}
+			rp = NULL;
+			switch(edi__parser_detect(r->oparser, pos, end - pos, &(r->parser), &skip, &rp))
+			{
+				case -1:
+					err = EDI_ERR_SYSTEM;
+					break;
+				case 1:
+					strcpy(r->dialect, rp->name);
+					pos += skip;
+					break;
+			}
+			if(EDI_ERR_NONE != err)
+			{
+				break;
+			}
+			r->detected = 1;
+			continue;
+		}
+		start = pos;
+		err = edi__parse_segment(&(r->parser), r->interchange, &(r->state), &pos, end);
+		if(EDI_ERR_UNTERMINATED == err && !final)
+		{
+			/* Wait for the rest of the segment */
+			edi__interchange_reset(r->interchange);
+			r->state.nsegments--;
+			r->state.mem = sizeof(edi_segment_t) * r->interchange->private_->segalloc;
+			r->retry = (end - start) * 2;
+			pos = start;
+			err = EDI_ERR_NONE;
+			break;
+		}
+		if(EDI_ERR_NONE != err)
+		{
+			edi__interchange_reset(r->interchange);
+			pos = start;
+			break;
+		}
+		edi__reader_nest(r, &(r->interchange->segments[0]));
+		r->offset += pos - mark;
+		mark = pos;
+		if(NULL != cb && 0 != cb(r, &(r->interchange->segments[0]), ctx))
+		{
+			err = EDI_ERR_STOPPED;
+		}
+		edi__interchange_reset(r->interchange);
+		r->state.mem = sizeof(edi_segment_t) * r->interchange->private_->segalloc;
+		if(EDI_ERR_NONE != err)
+		{
+			break;
+		}
+	}
+	/* Account for any inter-segment whitespace or header which was
+	 * skipped
+	 */
+	r->offset += pos - mark;
+	*consumed = pos - data;
+	if(EDI_ERR_NONE != err && EDI_ERR_STOPPED != err)
+	{
+		r->error = err;
+	}
+	return err;
+}
+
+/* Add @len bytes to the reader's buffer */
+static int
+edi__reader_append(edi_reader_t *r, const char *data, size_t len)
+{
+	size_t n;
+	char *p;
+	
+	if(!len)
+	{
+		return 0;
+	}
+	if(r->buflen + len > r->bufalloc)
+	{
+		for(n = (r->bufalloc ? r->bufalloc : READER_DETECT_MIN); n < r->buflen + len; n *= 2)
+		{
+		}
+		if(NULL == (p = (char *) realloc(r->buf, n)))
+		{
+			return -1;
+		}
+		r->buf = p;
+		r->bufalloc = n;
+	}
+	memcpy(r->buf + r->buflen, data, len);
+	r->buflen += len;
+	return 0;
+}
+
+/* Discard the first @len bytes of the reader's buffer */
+static void
+edi__reader_consume(edi_reader_t *r, size_t len)
+{
+	if(len)
+	{
+		memmove(r->buf, r->buf + len, r->buflen - len);
+		r->buflen -= len;
+	}
+}
+
+/* Update the list of open containers following @seg */
+static void
+edi__reader_nest(edi_reader_t *r, const edi_segment_t *seg)
+{
+	size_t c;
+	
+	if(NULL == seg->tag)
+	{
+		return;
+	}
+	/* An end segment closes its container and any left open within it */
+	for(c = r->depth; c > 0; c--)
+	{
+		if(edi__container_match(seg, r->parser.containers[r->stack[c - 1]].end, r->parser.containers[r->stack[c - 1]].endcode))
+		{
+			r->depth = c - 1;
+			return;
+		}
+	}
+	for(c = 0; c < r->parser.ncontainers; c++)
+	{
+		if(edi__container_match(seg, r->parser.containers[c].start, r->parser.containers[c].startcode))
+		{
+			if(r->depth < READER_DEPTH)
+			{
+				r->stack[r->depth] = c;
+				r->depth++;
+			}
+			return;
+		}
+	}
+}
+
+/* Restore the state recorded in a checkpoint */
+static int
+edi__reader_restore(edi_reader_t *r, const char *s)
+{
+	const edi_regparams_t *rp;
+	const char *p;
+	int sep[5];
+	off_t n;
+	size_t c;
+	
+	if('1' != s[0] || ':' != s[1])
+	{
+		return -1;
+	}
+	if(NULL == (s = edi__reader_number(s + 2, &(r->offset))) || ':' != *s)
+	{
+		return -1;
+	}
+	if(NULL == (s = edi__reader_number(s + 1, &n)) || ':' != *s)
+	{
+		return -1;
+	}
+	r->state.nsegments = (size_t) n;
+	s++;
+	for(c = 0; c < 10; c++)
+	{
+		if(!s[c] || NULL == (p = strchr(hexdigits, s[c])))
+		{
+			return -1;
+		}
+		if(c & 1)
+		{
+			sep[c / 2] |= (p - hexdigits);
+		}
+		else
+		{
+			sep[c / 2] = (p - hexdigits) << 4;
+		}
+	}
+	s += 10;
+	if(':' != *s)
+	{
+		return -1;
+	}
+	/* The dialect determines the container list, so must come first */
+	if(NULL == (p = strchr(s + 1, ':')))
+	{
+		return -1;
+	}
+	if(p[1])
+	{
+		if(NULL == (rp = edi_detect_get(p + 1)))
+		{
+			return -1;
+		}
+		if(-1 == edi__parser_init(&(r->parser), &(rp->params)))
+		{
+			return -1;
+		}
+		memcpy(r->parser.skip, r->oparser->skip, sizeof(r->parser.skip));
+		r->parser.limits = r->oparser->limits;
+		strncpy(r->dialect, p + 1, sizeof(r->dialect) - 1);
+	}
+	r->parser.sep_seg = sep[0];
+	r->parser.sep_data = sep[1];
+	r->parser.sep_sub = sep[2];
+	r->parser.sep_tag = sep[3];
+	r->parser.escape = sep[4];
+	for(s++; s < p; s++)
+	{
+		if(NULL == (s = edi__reader_number(s, &n)) || (size_t) n >= r->parser.ncontainers ||
+			r->depth >= READER_DEPTH || ('.' != *s && ':' != *s))
+		{
+			return -1;
+		}
+		r->stack[r->depth] = (size_t) n;
+		r->depth++;
+	}
+	r->detected = (r->detected || r->offset || r->dialect[0]);
+	return 0;
+}
+
+/* Read a decimal number from @s, returning a pointer to the following
+ * character, or NULL if there were no digits.
+ */
+static const char *
+edi__reader_number(const char *s, off_t *result)
+{
+	if(*s < '0' || *s > '9')
+	{
+		return NULL;
+	}
+	for(*result = 0; *s >= '0' && *s <= '9'; s++)
+	{
+		*result = (*result * 10) + (*s - '0');
+	}
+	return s;
+}
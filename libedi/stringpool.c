@@ -77,15 +77,30 @@ edi__stringpool_get(edi_interchange_t *msg, size_t minsize)
 char *
 edi__stringpool_alloc(edi_interchange_t *msg, size_t length)
 {
-	size_t n;
+	ssize_t n;
 	char *sp;
 
-	n = edi__stringpool_get(msg, length);
+	if(-1 == (n = edi__stringpool_get(msg, length)))
+	{
+		return NULL;
+	}
 	sp = msg->private_->sp[n];
 	msg->private_->sp[n] += length;
 	return sp;
 }
 
+/* Mark all of a message's stringpools as empty, without releasing them */
+void
+edi__stringpool_reset(edi_interchange_t *msg)
+{
+	size_t c;
+	
+	for(c = 0; c < msg->private_->npools; c++)
+	{
+		msg->private_->sp[c] = msg->private_->stringpool[c];
+	}
+}
+
 /* Destroy all of a message's stringpools */
 int
 edi__stringpool_destroy(edi_interchange_t *msg)
@@ -105,20 +120,3 @@ edi__stringpool_destroy(edi_interchange_t *msg)
 	msg->private_->npools = 0;
 	return 0;
 }
-
-/* Free the buffer p, if it's not contained within the message's stringpools */
-int
-edi__stringpool_free(edi_interchange_t *msg, char *p)
-{
-	size_t c;
-	
-	for(c = 0; c < msg->private_->npools; c++)
-	{
-		if(p >= msg->private_->stringpool[c] && p < msg->private_->sp[c])
-		{
-			return 0;
-		}
-	}
-	free(p);
-	return 0;
-}
@@ -46,8 +46,8 @@
  */
 
 static const edi_detector_t edi__tradacoms_detectors[] = {
-	{ "STX", 0, 0, 0, 0, 0, 0, 0 },
-	{ NULL, 0, 0, 0, 0, 0, 0, 0 }
+	{ "STX", 0, 0, 0, 0, 0, 0, 0, 2 },
+	{ NULL, 0, 0, 0, 0, 0, 0, 0, 0 }
 };
 
 static const edi_params_t edi__tradacoms_params = {
@@ -60,5 +60,14 @@ static const edi_params_t edi__tradacoms_params = {
 	"TRADACOMS",
 	"STX/END,MHD/MTR",
 	NULL,
-	NULL
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	0,
+	0,
+	0,
+	0,
+	0,
+	0
 };
@@ -0,0 +1,548 @@
+/* @(#) $Id$ */
+
+/*
+ * Copyright (c) 2003, 2004, 2005, 2006, 2007, 2008 Mo McRoberts.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) of this software may not be used to endorse
+ *    or promote products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY 
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * AUTHORS OF THIS SOFTWARE BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF 
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS 
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "p_libedi.h"
+
+/* Convert an interchange from one set of separators to another without
+ * building a tree. Each segment is scanned for the source separators and
+ * escape character, and the runs between them are written out, escaped for
+ * the target parameters, in place of the values which the parser would have
+ * produced. The output is identical to that of parsing the whole interchange
+ * and building it again, including the service string advice, but only
+ * the incomplete segment at the end of the data supplied so far (if any) is
+ * held in memory.
+ */
+
+static void edi__transcoder_source(edi_transcoder_t *t);
+static int edi__transcoder_run(edi_transcoder_t *t, const char *data, size_t len, int final, size_t *consumed);
+static int edi__transcoder_emit(edi_transcoder_t *t, const char **msgp, const char *end);
+static int edi__transcoder_segment(const edi_transcoder_t *t, edi_sink_t *sink, const char **msgp, const char *end, int first);
+static const char *edi__transcoder_value(const edi_transcoder_t *t, edi_sink_t *sink, int raw, const char *p, const char *end, int tag, char *copy, size_t *copylen, size_t copymax);
+static int edi__transcoder_flush(edi_transcoder_t *t);
+static int edi__transcoder_append(edi_transcoder_t *t, const char *data, size_t len);
+static void edi__transcoder_consume(edi_transcoder_t *t, size_t len);
+
+edi_transcoder_t *
+edi_transcoder_create(const edi_parser_t *parser, const edi_params_t *params, edi_builder_cb cb, void *data)
+{
+	edi_transcoder_t *t;
+	
+	if(NULL == parser)
+	{
+		return NULL;
+	}
+	if(NULL == (t = (edi_transcoder_t *) calloc(1, sizeof(edi_transcoder_t))))
+	{
+		return NULL;
+	}
+	t->oparser = parser;
+	memcpy(&(t->parser), parser, sizeof(edi_parser_t));
+	t->detected = !parser->detect;
+	edi__transcoder_source(t);
+	if(-1 == edi__emitter_init(&(t->em), params))
+	{
+		free(t);
+		return NULL;
+	}
+	t->cb = cb;
+	t->data = data;
+	if(NULL == (t->buf = (unsigned char *) malloc(BUILDER_BUFSIZE)))
+	{
+		free(t);
+		return NULL;
+	}
+	t->bufalloc = BUILDER_BUFSIZE;
+	return t;
+}
+
+int
+edi_transcoder_destroy(edi_transcoder_t *t)
+{
+	free(t->in);
+	free(t->buf);
+	free(t);
+	return 0;
+}
+
+int
+edi_transcoder_feed(edi_transcoder_t *t, const char *buf, size_t len)
+{
+	size_t n;
+	int err;
+	
+	if(EDI_ERR_NONE != t->error)
+	{
+		return t->error;
+	}
+	if(0 == t->inlen)
+	{
+		/* Nothing is held over from the previous call, so transcode
+		 * directly from the caller's buffer and keep only what's left.
+		 */
+		err = edi__transcoder_run(t, buf, len, 0, &n);
+		if(-1 == edi__transcoder_append(t, buf + n, len - n))
+		{
+			return (t->error = EDI_ERR_SYSTEM);
+		}
+		return err;
+	}
+	if(-1 == edi__transcoder_append(t, buf, len))
+	{
+		return (t->error = EDI_ERR_SYSTEM);
+	}
+	/* As with a reader, don't rescan an incomplete segment until there's
+	 * a reasonable amount more of it.
+	 */
+	if(t->inlen < t->retry)
+	{
+		return EDI_ERR_NONE;
+	}
+	err = edi__transcoder_run(t, t->in, t->inlen, 0, &n);
+	edi__transcoder_consume(t, n);
+	return err;
+}
+
+int
+edi_transcoder_finish(edi_transcoder_t *t)
+{
+	size_t n;
+	int err;
+	
+	if(EDI_ERR_NONE != t->error)
+	{
+		return t->error;
+	}
+	err = edi__transcoder_run(t, t->in, t->inlen, 1, &n);
+	edi__transcoder_consume(t, n);
+	if(-1 == edi__transcoder_flush(t) && EDI_ERR_NONE == err)
+	{
+		err = (t->error = EDI_ERR_SYSTEM);
+	}
+	return err;
+}
+
+/* Prepare to scan for the separators of the parser in use */
+static void
+edi__transcoder_source(edi_transcoder_t *t)
+{
+	t->src.sep_seg = (unsigned char) t->parser.sep_seg;
+	t->src.sep_data = (unsigned char) t->parser.sep_data;
+	t->src.sep_sub = (unsigned char) t->parser.sep_sub;
+	t->src.sep_tag = (unsigned char) t->parser.sep_tag;
+	t->src.escape = (unsigned char) t->parser.escape;
+	edi__escape_specials(&(t->src));
+}
+
+/* Transcode as many segments as possible from @data, setting @consumed to
+ * the number of bytes which need not be supplied again. Unless @final is
+ * set, an incomplete segment at the end of @data is not an error.
+ */
+static int
+edi__transcoder_run(edi_transcoder_t *t, const char *data, size_t len, int final, size_t *consumed)
+{
+	const char *pos, *end, *start;
+	size_t skip;
+	int err;
+	
+	pos = data;
+	end = data + len;
+	err = EDI_ERR_NONE;
+	t->retry = 0;
+	while(1)
+	{
+		while(pos < end && t->parser.skip[(unsigned char) *pos])
+		{
+			pos++;
+		}
+		if(pos >= end)
+		{
+			break;
+		}
+		if(!t->detected)
+		{
+			if(!final && (size_t) (end - pos) < READER_DETECT_MIN)
+			{
+				t->retry = READER_DETECT_MIN;
+				break;
+			}
+			switch(edi__parser_detect(t->oparser, pos, end - pos, &(t->parser), &skip, NULL))
+			{
+				case -1:
+					err = EDI_ERR_SYSTEM;
+					break;
+				case 1:
+					edi__transcoder_source(t);
+					pos += skip;
+					break;
+			}
+			if(EDI_ERR_NONE != err)
+			{
+				break;
+			}
+			t->detected = 1;
+			continue;
+		}
+		start = pos;
+		err = edi__transcoder_emit(t, &pos, end);
+		if(EDI_ERR_UNTERMINATED == err && !final)
+		{
+			/* Wait for the rest of the segment */
+			t->retry = (end - start) * 2;
+			pos = start;
+			err = EDI_ERR_NONE;
+			break;
+		}
+		if(EDI_ERR_NONE != err)
+		{
+			pos = start;
+			break;
+		}
+	}
+	*consumed = pos - data;
+	if(EDI_ERR_NONE != err)
+	{
+		t->error = err;
+	}
+	return err;
+}
+
+/* Transcode the segment at *@msgp into the output buffer, flushing it first
+ * if necessary.
+ */
+static int
+edi__transcoder_emit(edi_transcoder_t *t, const char **msgp, const char *end)
+{
+	edi_sink_t sink;
+	const char *p;
+	unsigned char *bp;
+	size_t n;
+	int err, first;
+	
+	first = (0 == t->nsegments);
+	p = *msgp;
+	sink.buf = t->buf + t->buflen;
+	sink.buflen = t->bufalloc - t->buflen;
+	sink.pos = 0;
+	sink.iov = NULL;
+	if(EDI_ERR_NONE != (err = edi__transcoder_segment(t, &sink, &p, end, first)))
+	{
+		return err;
+	}
+	if(sink.pos > sink.buflen)
+	{
+		if(-1 == edi__transcoder_flush(t))
+		{
+			return EDI_ERR_SYSTEM;
+		}
+		if(sink.pos > t->bufalloc)
+		{
+			for(n = t->bufalloc * 2; n < sink.pos; n *= 2)
+			{
+			}
+			if(NULL == (bp = (unsigned char *) realloc(t->buf, n)))
+			{
+				return EDI_ERR_SYSTEM;
+			}
+			t->buf = bp;
+			t->bufalloc = n;
+		}
+		sink.buf = t->buf;
+		sink.buflen = t->bufalloc;
+		sink.pos = 0;
+		p = *msgp;
+		edi__transcoder_segment(t, &sink, &p, end, first);
+	}
+	t->buflen += sink.pos;
+	t->nsegments++;
+	*msgp = p;
+	return EDI_ERR_NONE;
+}
+
+/* Transcode a single segment at *@msgp (which must not be inter-segment
+ * whitespace), advancing *@msgp past its segment separator. This follows
+ * edi__parse_segment() and edi__emit_segment() exactly.
+ */
+static int
+edi__transcoder_segment(const edi_transcoder_t *t, edi_sink_t *sink, const char **msgp, const char *end, int first)
+{
+	char tag[TRANSCODER_TAGMAX], num[24];
+	const char *p, *q;
+	size_t taglen, numlen, binlen, tbinel, d, c;
+	int tagok, hdr, raw, bin, composite;
+	
+	p = *msgp;
+	tagok = 0;
+	hdr = 0;
+	tbinel = 0;
+	if(p < end && *p != (char) t->src.sep_seg)
+	{
+		/* The tag decides whether the segment has a binary payload and
+		 * whether it is the header, so find it first.
+		 */
+		q = edi__transcoder_value(t, NULL, 0, p, end, 1, tag, &taglen, sizeof(tag) - 1);
+		if(q >= end)
+		{
+			return EDI_ERR_UNTERMINATED;
+		}
+		if(taglen < sizeof(tag))
+		{
+			tag[taglen] = 0;
+			tagok = 1;
+		}
+		for(c = 0; tagok && c < t->em.nbinary; c++)
+		{
+			if(0 == strcmp(tag, t->em.binary[c].tag))
+			{
+				tbinel = t->em.binary[c].element + 1;
+				break;
+			}
+		}
+		if(first && NULL != t->em.hdrname)
+		{
+			if(tagok && taglen == strlen(t->em.hdrname) && 0 == memcmp(t->em.hdrname, tag, taglen))
+			{
+				hdr = 1;
+			}
+			else
+			{
+				edi__emit_header(&(t->em), sink);
+			}
+		}
+	}
+	bin = 0;
+	binlen = 0;
+	d = 0;
+	while(p < end && (bin || *p != (char) t->src.sep_seg))
+	{
+		if(d)
+		{
+			edi__emit_char(sink, (1 == d ? t->em.sep_tag : t->em.sep_data));
+		}
+		if(bin)
+		{
+			/* A binary payload, which is not scanned */
+			if((size_t) (end - p) < binlen)
+			{
+				return EDI_ERR_UNTERMINATED;
+			}
+			edi__emit_value(&(t->em), sink, p, binlen, (0 != tbinel && d == tbinel));
+			p += binlen;
+			bin = 0;
+			if(p >= end || *p == (char) t->src.sep_seg)
+			{
+				break;
+			}
+			if(*p != (char) t->src.sep_data)
+			{
+				return EDI_ERR_BINARY;
+			}
+			p++;
+			d++;
+			continue;
+		}
+		raw = 0;
+		if(0 != tbinel && d == tbinel)
+		{
+			/* The target's payloads are written unescaped, but only
+			 * if they are simple elements.
+			 */
+			q = edi__transcoder_value(t, NULL, 0, p, end, 0, NULL, &numlen, 0);
+			raw = (q >= end || *q != (char) t->src.sep_sub);
+		}
+		for(composite = 0; ; composite = 1)
+		{
+			if(composite)
+			{
+				edi__emit_char(sink, t->em.sep_sub);
+			}
+			p = edi__transcoder_value(t, sink, raw, p, end, (0 == d), num, &numlen, sizeof(num));
+			if(p >= end)
+			{
+				return EDI_ERR_UNTERMINATED;
+			}
+			if(*p != (char) t->src.sep_sub)
+			{
+				break;
+			}
+			/* As when parsing, a segment separator immediately
+			 * following a separator does not begin a new value.
+			 */
+			if(++p < end && *p == (char) t->src.sep_seg)
+			{
+				break;
+			}
+		}
+		if(*p == (char) t->src.sep_seg)
+		{
+			break;
+		}
+		/* A tag or data element separator */
+		if(!composite && tagok && t->parser.nbinary)
+		{
+			for(c = 0; c < t->parser.nbinary; c++)
+			{
+				if(d == t->parser.binary[c].element && 0 == strcmp(tag, t->parser.binary[c].tag))
+				{
+					if(numlen > sizeof(num) || -1 == edi__binary_length(num, numlen, &binlen))
+					{
+						return EDI_ERR_BINARY;
+					}
+					bin = 1;
+					break;
+				}
+			}
+		}
+		p++;
+		d++;
+	}
+	if(p >= end)
+	{
+		return EDI_ERR_UNTERMINATED;
+	}
+	edi__emit_end(&(t->em), sink, hdr);
+	*msgp = p + 1;
+	return EDI_ERR_NONE;
+}
+
+/* Transcode the value (or component) at @p, writing it to @sink (if not NULL)
+ * and copying up to @copymax octets of it, unescaped, to @copy; @copylen is
+ * set to its full length. Returns a pointer to the separator which ends it,
+ * or @end if it is incomplete. @tag is set if the value is part of the tag,
+ * which is ended by the tag separator rather than the data element
+ * separator.
+ */
+static const char *
+edi__transcoder_value(const edi_transcoder_t *t, edi_sink_t *sink, int raw, const char *p, const char *end, int tag, char *copy, size_t *copylen, size_t copymax)
+{
+	unsigned char ch;
+	size_t n;
+	
+	*copylen = 0;
+	while(p < end)
+	{
+		n = edi__escape_scan(&(t->src), p, end - p);
+		if(n)
+		{
+			if(NULL != sink)
+			{
+				edi__emit_value(&(t->em), sink, p, n, raw);
+			}
+			if(*copylen < copymax)
+			{
+				memcpy(copy + *copylen, p, (n < copymax - *copylen ? n : copymax - *copylen));
+			}
+			*copylen += n;
+			p += n;
+			if(p >= end)
+			{
+				break;
+			}
+		}
+		ch = (unsigned char) *p;
+		if(t->src.escape && ch == t->src.escape)
+		{
+			if(p + 1 >= end)
+			{
+				return end;
+			}
+			p++;
+		}
+		else if(ch == t->src.sep_sub || ch == t->src.sep_seg ||
+			(tag ? ch == t->src.sep_tag : ch == t->src.sep_data))
+		{
+			return p;
+		}
+		/* An escaped octet, or a separator which has no meaning here */
+		if(NULL != sink)
+		{
+			edi__emit_value(&(t->em), sink, p, 1, raw);
+		}
+		if(*copylen < copymax)
+		{
+			copy[*copylen] = *p;
+		}
+		(*copylen)++;
+		p++;
+	}
+	return end;
+}
+
+/* Pass the contents of the output buffer to the callback */
+static int
+edi__transcoder_flush(edi_transcoder_t *t)
+{
+	if(t->buflen && -1 == t->cb(t->data, (const char *) t->buf, t->buflen))
+	{
+		return -1;
+	}
+	t->buflen = 0;
+	return 0;
+}
+
+/* Add @len bytes to the transcoder's input buffer */
+static int
+edi__transcoder_append(edi_transcoder_t *t, const char *data, size_t len)
+{
+	size_t n;
+	char *p;
+	
+	if(!len)
+	{
+		return 0;
+	}
+	if(t->inlen + len > t->inalloc)
+	{
+		for(n = (t->inalloc ? t->inalloc : READER_DETECT_MIN); n < t->inlen + len; n *= 2)
+		{
+		}
+		if(NULL == (p = (char *) realloc(t->in, n)))
+		{
+			return -1;
+		}
+		t->in = p;
+		t->inalloc = n;
+	}
+	memcpy(t->in + t->inlen, data, len);
+	t->inlen += len;
+	return 0;
+}
+
+/* Discard the first @len bytes of the input buffer */
+static void
+edi__transcoder_consume(edi_transcoder_t *t, size_t len)
+{
+	if(len)
+	{
+		memmove(t->in, t->in + len, t->inlen - len);
+		t->inlen -= len;
+	}
+}
@@ -0,0 +1,144 @@
+/* @(#) $Id$ */
+
+/*
+ * Copyright (c) 2003, 2004, 2005, 2006, 2007, 2008 Mo McRoberts.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) of this software may not be used to endorse
+ *    or promote products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY 
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * AUTHORS OF THIS SOFTWARE BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF 
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS 
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "p_libedi.h"
+
+/* Serialize interchanges in pieces of any size. Each segment is staged in
+ * full and then copied out, so a piece may end part-way through a segment
+ * or an escape sequence, and no more than one segment is ever held.
+ */
+
+static int edi__writer_stage(edi_writer_t *w);
+
+edi_writer_t *
+edi_writer_begin(edi_interchange_t *msg, const edi_params_t *params)
+{
+	edi_writer_t *w;
+	
+	if(NULL == (w = (edi_writer_t *) calloc(1, sizeof(edi_writer_t))))
+	{
+		return NULL;
+	}
+	w->msg = msg;
+	if(-1 == edi__emitter_init(&(w->em), params))
+	{
+		free(w);
+		return NULL;
+	}
+	return w;
+}
+
+size_t
+edi_writer_fill(edi_writer_t *w, char *buf, size_t buflen)
+{
+	size_t n, len;
+	
+	len = 0;
+	while(len < buflen && !w->error)
+	{
+		if(w->bufpos >= w->buflen)
+		{
+			if(w->segment >= w->msg->nsegments)
+			{
+				break;
+			}
+			if(-1 == edi__writer_stage(w))
+			{
+				w->error = 1;
+				break;
+			}
+		}
+		n = w->buflen - w->bufpos;
+		if(n > buflen - len)
+		{
+			n = buflen - len;
+		}
+		memcpy(buf + len, w->buf + w->bufpos, n);
+		w->bufpos += n;
+		len += n;
+	}
+	return len;
+}
+
+int
+edi_writer_done(edi_writer_t *w)
+{
+	int r;
+	
+	r = 0;
+	if(w->error || w->bufpos < w->buflen || w->segment < w->msg->nsegments)
+	{
+		r = -1;
+	}
+	free(w->buf);
+	free(w);
+	return r;
+}
+
+/* Serialize the next segment into the staging buffer */
+static int
+edi__writer_stage(edi_writer_t *w)
+{
+	edi_sink_t sink;
+	const edi_segment_t *seg;
+	unsigned char *p;
+	size_t n;
+	
+	seg = &(w->msg->segments[w->segment]);
+	sink.buf = w->buf;
+	sink.buflen = w->bufalloc;
+	sink.pos = 0;
+	sink.iov = NULL;
+	edi__emit_segment(&(w->em), &sink, seg, 0 == w->segment);
+	if(sink.pos > w->bufalloc)
+	{
+		/* It didn't fit, so grow the buffer and try again */
+		for(n = (w->bufalloc ? w->bufalloc : WRITER_BLOCKSIZE); n < sink.pos; n *= 2)
+		{
+		}
+		if(NULL == (p = (unsigned char *) realloc(w->buf, n)))
+		{
+			return -1;
+		}
+		w->buf = p;
+		w->bufalloc = n;
+		sink.buf = w->buf;
+		sink.buflen = w->bufalloc;
+		sink.pos = 0;
+		edi__emit_segment(&(w->em), &sink, seg, 0 == w->segment);
+	}
+	w->buflen = sink.pos;
+	w->bufpos = 0;
+	w->segment++;
+	return 0;
+}
@@ -33,11 +33,13 @@
  * - Where EDIFACT uses UNZ, X12 uses IEA
  * - Where EDIFACT uses UNG/UNE, X12 uses GS/GE
  * - An additional group, ST/SE, is used to mark a "transactional set"
+ * - Binary data may be carried in BIN (length in BIN01, data in BIN02) and
+ *   BDS (length in BDS02, data in BDS03) segments
  */
 
 static const edi_detector_t edi__x12_detectors[] = {
-	{ "ISA", 0, 0, 105, 6, 104, 3, 0 },
-	{ NULL, 0, 0, 0, 0, 0, 0, 0 }
+	{ "ISA", 0, 0, 105, 6, 104, 3, 0, 6 },
+	{ NULL, 0, 0, 0, 0, 0, 0, 0, 0 }
 };
 
 /* The separators are always specified in the ISA header, so the defaults
@@ -51,7 +53,16 @@ static const edi_params_t edi__x12_params = {
 	':',
 	0,
 	"X12",
-	"ISA/IEA,GS/GE,ST/SE",
+	"ISA/IEA:13,GS/GE:6,ST/SE:2",
 	"ISA",
-	"%_%E%s%S"
+	"%_%E%s%S",
+	NULL,
+	NULL,
+	"BIN:1,BDS:2",
+	0,
+	0,
+	0,
+	0,
+	0,
+	0
 };
@@ -23,6 +23,31 @@ echo "Test run started at `date`" >&2
 runtest ./test-1
 runtest ./test-2
 runtest ./test-3
+runtest ./test-4
+runtest ./test-5
+runtest ./test-6
+runtest ./test-7
+runtest ./test-8
+runtest ./test-9
+runtest ./test-10
+runtest ./test-11
+runtest ./test-12
+runtest ./test-13
+runtest ./test-14
+runtest ./test-15
+runtest ./test-16
+runtest ./test-17
+runtest ./test-18
+runtest ./test-19
+runtest ./test-20
+runtest ./test-21
+runtest ./test-22
+runtest ./test-23
+runtest ./test-24
+runtest ./test-25
+runtest ./test-26
+runtest ./test-27
+runtest ./test-28
 
 echo "Test run completed at `date`" >&2
 
@@ -0,0 +1,196 @@
+/* test-10: check that a reader delivers the same segments as
+ * edi_parser_parse_r() however the input is divided, and that a reader
+ * created from a checkpoint resumes with the detected separators and open
+ * containers.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libedi.h"
+
+const char *msg = 
+	"UNA:*.? !\r\n"
+	"UNB*IATB:1*6XPPC*LHPPC*940101:0950*1!\r\n"
+	"UNH*1*PAORES:93:1:IA!\r\n"
+	"IFT*3*XYZCOMPANY AVAILABILITY?! PLEASE CALL!\r\n"
+	"UNT*3*1!\r\n"
+	"UNZ*1*1!\r\n";
+
+struct collect
+{
+	char tags[256];
+	const char *stopat;
+	char last[64];
+};
+
+static int
+collect(edi_reader_t *reader, const edi_segment_t *seg, void *data)
+{
+	struct collect *c;
+	const edi_element_t *el;
+	
+	(void) reader;
+	
+	c = (struct collect *) data;
+	strcat(c->tags, seg->tag);
+	strcat(c->tags, " ");
+	el = &(seg->elements[seg->nelements - 1]);
+	if(EDI_ELEMENT_SIMPLE == el->type)
+	{
+		strcpy(c->last, el->simple.value);
+	}
+	return (NULL != c->stopat && 0 == strcmp(c->stopat, seg->tag));
+}
+
+int
+main(int argc, char **argv)
+{
+	edi_params_t params;
+	edi_parser_t *p;
+	edi_reader_t *rd;
+	edi_parser_t *q;
+	edi_interchange_t *i;
+	const edi_group_t *g;
+	struct collect c;
+	char cp[EDI_CHECKPOINT_MAX];
+	size_t len, step, pos, n;
+	off_t offset;
+	int r, e;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	params = edi_edifact_params;
+	params.segment_whitespace = "\r\n";
+	p = edi_parser_create(&params);
+	len = strlen(msg);
+	for(step = 1; step <= len; step++)
+	{
+		memset(&c, 0, sizeof(c));
+		rd = edi_reader_create(p, NULL);
+		e = EDI_ERR_NONE;
+		for(pos = 0; pos < len && EDI_ERR_NONE == e; pos += n)
+		{
+			n = (len - pos < step ? len - pos : step);
+			e = edi_reader_feed(rd, msg + pos, n, collect, &c);
+		}
+		if(EDI_ERR_NONE == e)
+		{
+			e = edi_reader_finish(rd, collect, &c);
+		}
+		if(EDI_ERR_NONE != e || strcmp(c.tags, "UNB UNH IFT UNT UNZ ") ||
+			strcmp(c.last, "1") || (off_t) len != edi_reader_offset(rd))
+		{
+			fprintf(stderr, "reading in pieces of %lu bytes: error %d, segments '%s'\n", (unsigned long) step, e, c.tags);
+			r = 1;
+		}
+		edi_reader_destroy(rd);
+	}
+	
+	/* Stop after the UNH segment and take a checkpoint */
+	memset(&c, 0, sizeof(c));
+	c.stopat = "UNH";
+	rd = edi_reader_create(p, NULL);
+	e = edi_reader_feed(rd, msg, len, collect, &c);
+	offset = edi_reader_offset(rd);
+	if(EDI_ERR_STOPPED != e || 2 != edi_reader_depth(rd) ||
+		strcmp("UNB", edi_reader_container(rd, 0)) || strcmp("UNH", edi_reader_container(rd, 1)) ||
+		offset != (off_t) (strstr(msg, "IFT") - msg - 2))
+	{
+		fprintf(stderr, "reader did not stop after UNH\n");
+		r = 1;
+	}
+	if(edi_reader_checkpoint(rd, cp, sizeof(cp)) >= sizeof(cp))
+	{
+		fprintf(stderr, "checkpoint does not fit in EDI_CHECKPOINT_MAX bytes\n");
+		r = 1;
+	}
+	edi_reader_destroy(rd);
+	
+	/* Resume from the checkpoint */
+	memset(&c, 0, sizeof(c));
+	if(NULL == (rd = edi_reader_create(p, cp)))
+	{
+		fprintf(stderr, "failed to resume from checkpoint '%s'\n", cp);
+		return 1;
+	}
+	if(2 != edi_reader_depth(rd) || offset != edi_reader_offset(rd))
+	{
+		fprintf(stderr, "checkpoint '%s' did not restore the reader's position\n", cp);
+		r = 1;
+	}
+	c.stopat = "UNT";
+	e = edi_reader_feed(rd, msg + offset, len - offset, collect, &c);
+	if(EDI_ERR_STOPPED != e || 1 != edi_reader_depth(rd))
+	{
+		fprintf(stderr, "resumed reader did not close UNH\n");
+		r = 1;
+	}
+	e = edi_reader_finish(rd, collect, &c);
+	if(EDI_ERR_NONE != e || strcmp(c.tags, "IFT UNT UNZ ") || 0 != edi_reader_depth(rd))
+	{
+		fprintf(stderr, "resumed reader: error %d, segments '%s'\n", e, c.tags);
+		r = 1;
+	}
+	edi_reader_destroy(rd);
+	
+	/* An incomplete final segment is an error */
+	memset(&c, 0, sizeof(c));
+	rd = edi_reader_create(p, NULL);
+	edi_reader_feed(rd, msg, len - 3, collect, &c);
+	if(EDI_ERR_UNTERMINATED != edi_reader_finish(rd, collect, &c) || strcmp(c.tags, "UNB UNH IFT UNT "))
+	{
+		fprintf(stderr, "reader did not report an unterminated segment\n");
+		r = 1;
+	}
+	edi_reader_destroy(rd);
+	
+	/* A containers list which can't be compiled doesn't prevent parsing */
+	params = edi_edifact_params;
+	params.containers = "UNB/UNZ;UNH/UNT";
+	if(NULL == (q = edi_parser_create(&params)))
+	{
+		fprintf(stderr, "parser with malformed containers was not created\n");
+		r = 1;
+	}
+	else
+	{
+		i = edi_parser_parse(q, "UNH+1+X'UNT+2+1'");
+		if(2 != i->nsegments || 0 != edi_interchange_ngroups(i, 0))
+		{
+			fprintf(stderr, "malformed containers were used\n");
+			r = 1;
+		}
+		edi_interchange_destroy(i);
+		edi_parser_destroy(q);
+	}
+	params.containers = "ENVELOPE/ENDENVELOPE";
+	if(NULL == (q = edi_parser_create(&params)))
+	{
+		fprintf(stderr, "parser with overlong container tags was not created\n");
+		r = 1;
+	}
+	else
+	{
+		edi_parser_destroy(q);
+	}
+	/* Whitespace around entries is ignored */
+	params.containers = " UNB / UNZ : 5 , UNH/UNT:1 ";
+	q = edi_parser_create(&params);
+	i = edi_parser_parse(q, "UNH+1+X'BGM+220'UNT+3+1'");
+	if(1 != edi_interchange_ngroups(i, 1) || NULL == (g = edi_interchange_group(i, 1, 0)) || 0 != g->start || 2 != g->end)
+	{
+		fprintf(stderr, "containers with whitespace were not used\n");
+		r = 1;
+	}
+	edi_interchange_destroy(i);
+	edi_parser_destroy(q);
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	edi_parser_destroy(p);
+	
+	return r;
+}
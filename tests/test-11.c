@@ -0,0 +1,119 @@
+/* test-11: check that edi_interchange_build_size() reports exactly the
+ * number of octets edi_interchange_build() produces, that building into a
+ * buffer of exactly that size doesn't overrun it, and that interchanges
+ * constructed with edi_segment_create() and edi_element_create() are built
+ * with their values.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libedi.h"
+
+const char edifact[] = 
+	"UNB+IATB:1+6XPPC+LHPPC+940101:0950+1'"
+	"UNH+1+PAORES:93:1:IA'"
+	"IFT+3+XYZCOMPANY AVAILABILITY?: PLEASE CALL?'"
+	"UNT+3+1'"
+	"UNZ+1+1'";
+
+const char x12[] = 
+	"ISA:00:          :00:          :01:1515151515     :01:5151515151     :041201:1217:U:00304:000032123:0:P:*~"
+	"GS:CT:9988776655:1122334455:041201:1217:128:X:003040~"
+	"ST:831:00128001~"
+	"BIN:11:~A:B*C\0D~~E~"
+	"SE:3:00128001~"
+	"GE:1:128~"
+	"IEA:1:000032123~";
+
+const char built[] = 
+	"UNB+UNOA:1+SENDER+RECIPIENT'"
+	"FTX+AAI+++MADE UP?+BUILT'"
+	"UNZ+1+1'";
+
+static int
+check(const char *name, edi_interchange_t *i, const edi_params_t *params, const char *expect, size_t expectlen)
+{
+	char *buf;
+	size_t size, len;
+	int r;
+	
+	r = 0;
+	size = edi_interchange_build_size(i, params);
+	buf = (char *) malloc(size + 1);
+	buf[size] = 'X';
+	len = edi_interchange_build(i, params, buf, size);
+	if(len != size || 'X' != buf[size])
+	{
+		fprintf(stderr, "%s: size %lu, but built %lu octets\n", name, (unsigned long) size, (unsigned long) len);
+		r = 1;
+	}
+	if(NULL != expect && (size != expectlen || memcmp(expect, buf, len)))
+	{
+		fprintf(stderr, "%s: generated output differs\n", name);
+		r = 1;
+	}
+	if(size > 10)
+	{
+		len = edi_interchange_build(i, params, buf, 10);
+		if(10 != len || 'X' != buf[size])
+		{
+			fprintf(stderr, "%s: truncated build returned %lu\n", name, (unsigned long) len);
+			r = 1;
+		}
+	}
+	free(buf);
+	return r;
+}
+
+int
+main(int argc, char **argv)
+{
+	edi_params_t params;
+	edi_parser_t *p;
+	edi_interchange_t *i;
+	edi_segment_t *seg;
+	edi_element_t *el;
+	int r;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	p = edi_parser_create(NULL);
+	
+	i = edi_parser_parse_buf(p, edifact, sizeof(edifact) - 1);
+	r |= check("EDIFACT", i, NULL, edifact, sizeof(edifact) - 1);
+	params = *(edi_detect_get_params("UN/EDIFACT"));
+	params.segment_newline = "\r\n";
+	r |= check("EDIFACT with UNA and line breaks", i, &params, NULL, 0);
+	edi_interchange_destroy(i);
+	
+	i = edi_parser_parse_buf(p, x12, sizeof(x12) - 1);
+	r |= check("X12", i, edi_detect_get_params("ANSI X12"), x12, sizeof(x12) - 1);
+	edi_interchange_destroy(i);
+	
+	i = edi_interchange_create();
+	seg = edi_segment_create(i, "UNB");
+	el = edi_element_create(seg, "UNOA");
+	edi_element_add(el, "1");
+	edi_element_create(seg, "SENDER");
+	edi_element_create(seg, "RECIPIENT");
+	seg = edi_segment_create(i, "FTX");
+	edi_element_create(seg, "AAI");
+	edi_element_create(seg, "");
+	edi_element_create(seg, "");
+	edi_element_create(seg, "MADE UP+BUILT");
+	seg = edi_segment_create(i, "UNZ");
+	edi_element_create(seg, "1");
+	edi_element_create(seg, "1");
+	r |= check("Constructed", i, NULL, built, sizeof(built) - 1);
+	edi_interchange_destroy(i);
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	edi_parser_destroy(p);
+	
+	return r;
+}
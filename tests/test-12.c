@@ -0,0 +1,89 @@
+/* test-12: check that a writer produces the same output as
+ * edi_interchange_build() however small the pieces it is asked for.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libedi.h"
+
+const char edifact[] = 
+	"UNB+IATB:1+6XPPC+LHPPC+940101:0950+1'"
+	"UNH+1+PAORES:93:1:IA'"
+	"IFT+3+XYZCOMPANY AVAILABILITY?: PLEASE CALL?'"
+	"UNT+3+1'"
+	"UNZ+1+1'";
+
+const char x12[] = 
+	"ISA:00:          :00:          :01:1515151515     :01:5151515151     :041201:1217:U:00304:000032123:0:P:*~"
+	"GS:CT:9988776655:1122334455:041201:1217:128:X:003040~"
+	"GE:1:128~"
+	"IEA:1:000032123~";
+
+static int
+check(const char *name, edi_interchange_t *i, const edi_params_t *params)
+{
+	char expect[1024], out[1024], piece[64];
+	size_t len, step, pos, n;
+	edi_writer_t *w;
+	int r;
+	
+	r = 0;
+	len = edi_interchange_build(i, params, expect, sizeof(expect));
+	for(step = 1; step <= sizeof(piece); step++)
+	{
+		w = edi_writer_begin(i, params);
+		pos = 0;
+		while(0 != (n = edi_writer_fill(w, piece, step)) && pos + n <= sizeof(out))
+		{
+			memcpy(out + pos, piece, n);
+			pos += n;
+		}
+		if(0 != edi_writer_done(w) || pos != len || memcmp(expect, out, len))
+		{
+			fprintf(stderr, "%s: output in pieces of %lu octets differs\n", name, (unsigned long) step);
+			r = 1;
+		}
+	}
+	w = edi_writer_begin(i, params);
+	edi_writer_fill(w, piece, 10);
+	if(-1 != edi_writer_done(w))
+	{
+		fprintf(stderr, "%s: incomplete output was not reported\n", name);
+		r = 1;
+	}
+	return r;
+}
+
+int
+main(int argc, char **argv)
+{
+	edi_params_t params;
+	edi_parser_t *p;
+	edi_interchange_t *i;
+	int r;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	p = edi_parser_create(NULL);
+	
+	i = edi_parser_parse_buf(p, edifact, sizeof(edifact) - 1);
+	r |= check("EDIFACT", i, NULL);
+	params = *(edi_detect_get_params("UN/EDIFACT"));
+	params.segment_newline = "\r\n";
+	r |= check("EDIFACT with UNA and line breaks", i, &params);
+	edi_interchange_destroy(i);
+	
+	i = edi_parser_parse_buf(p, x12, sizeof(x12) - 1);
+	r |= check("X12", i, edi_detect_get_params("ANSI X12"));
+	edi_interchange_destroy(i);
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	edi_parser_destroy(p);
+	
+	return r;
+}
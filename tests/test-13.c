@@ -0,0 +1,186 @@
+/* test-13: check that a streaming builder writes segments as they are
+ * completed and fills in the counts and control references of end segments.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libedi.h"
+
+const char *expect = 
+	"UNA:+.? '"
+	"UNB+UNOA:1+SENDER+RECIPIENT+940101:0950+REF42'"
+	"UNH+1+ORDERS:D:96A:UN'"
+	"BGM+220+PO?+1'"
+	"LIN+1'"
+	"LIN+2'"
+	"UNT+5+1'"
+	"UNH+2+ORDERS:D:96A:UN'"
+	"FTX+AAI+++NOTE'"
+	"UNT+3+2'"
+	"UNZ+2+REF42'";
+
+/* An empty control reference is not repeated in the end segment */
+const char *noref = 
+	"UNA:+.? '"
+	"UNH++ORDERS'"
+	"BGM+220'"
+	"UNT+3'";
+
+/* A control reference given by length is copied without a terminator */
+const char *byref = 
+	"UNA:+.? '"
+	"UNH+42+ORDERS'"
+	"UNT+2+42'";
+
+struct output
+{
+	char buf[1024];
+	size_t len;
+	size_t calls;
+};
+
+static int
+collect(void *data, const char *buf, size_t len)
+{
+	struct output *o;
+	
+	o = (struct output *) data;
+	if(o->len + len > sizeof(o->buf))
+	{
+		return -1;
+	}
+	memcpy(o->buf + o->len, buf, len);
+	o->len += len;
+	o->calls++;
+	return 0;
+}
+
+static int
+generate(edi_builder_t *b)
+{
+	edi_segment_t *seg;
+	edi_element_t *el;
+	
+	seg = edi_builder_segment(b, "UNB");
+	el = edi_element_create(seg, "UNOA");
+	edi_element_add(el, "1");
+	edi_element_create(seg, "SENDER");
+	edi_element_create(seg, "RECIPIENT");
+	el = edi_element_create(seg, "940101");
+	edi_element_add(el, "0950");
+	edi_element_create(seg, "REF42");
+	seg = edi_builder_segment(b, "UNH");
+	edi_element_create(seg, "1");
+	el = edi_element_create(seg, "ORDERS");
+	edi_element_add(el, "D");
+	edi_element_add(el, "96A");
+	edi_element_add(el, "UN");
+	seg = edi_builder_segment(b, "BGM");
+	edi_element_create(seg, "220");
+	edi_element_create(seg, "PO+1");
+	seg = edi_builder_segment(b, "LIN");
+	edi_element_create(seg, "1");
+	seg = edi_builder_segment(b, "LIN");
+	edi_element_create(seg, "2");
+	/* Filled in automatically */
+	edi_builder_segment(b, "UNT");
+	seg = edi_builder_segment(b, "UNH");
+	edi_element_create(seg, "2");
+	el = edi_element_create(seg, "ORDERS");
+	edi_element_add(el, "D");
+	edi_element_add(el, "96A");
+	edi_element_add(el, "UN");
+	seg = edi_builder_segment(b, "FTX");
+	edi_element_create(seg, "AAI");
+	edi_element_create(seg, "");
+	edi_element_create(seg, "");
+	edi_element_create(seg, "NOTE");
+	/* UNT and UNZ are written by edi_builder_finish() */
+	return edi_builder_finish(b);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct output o;
+	edi_builder_t *b;
+	edi_segment_t *seg;
+	char buf[1024], *ref;
+	FILE *f;
+	size_t len;
+	int r;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	memset(&o, 0, sizeof(o));
+	b = edi_builder_create(&edi_edifact_params, collect, &o);
+	if(0 != generate(b) || o.len != strlen(expect) || memcmp(o.buf, expect, o.len))
+	{
+		fprintf(stderr, "Generated output differs:\n%.*s\n", (int) o.len, o.buf);
+		r = 1;
+	}
+	if(10 != edi_builder_count(b))
+	{
+		fprintf(stderr, "Wrote %lu segments\n", (unsigned long) edi_builder_count(b));
+		r = 1;
+	}
+	edi_builder_destroy(b);
+	
+	if(NULL != (f = tmpfile()))
+	{
+		b = edi_builder_create_file(&edi_edifact_params, f);
+		if(0 != generate(b))
+		{
+			fprintf(stderr, "Failed to write to a file\n");
+			r = 1;
+		}
+		edi_builder_destroy(b);
+		rewind(f);
+		len = fread(buf, 1, sizeof(buf), f);
+		if(len != strlen(expect) || memcmp(buf, expect, len))
+		{
+			fprintf(stderr, "File output differs\n");
+			r = 1;
+		}
+		fclose(f);
+	}
+	
+	memset(&o, 0, sizeof(o));
+	b = edi_builder_create(&edi_edifact_params, collect, &o);
+	seg = edi_builder_segment(b, "UNH");
+	edi_element_create(seg, NULL);
+	edi_element_create(seg, "ORDERS");
+	seg = edi_builder_segment(b, "BGM");
+	edi_element_create(seg, "220");
+	if(0 != edi_builder_finish(b) || o.len != strlen(noref) || memcmp(o.buf, noref, o.len))
+	{
+		fprintf(stderr, "Output with an empty reference differs:\n%.*s\n", (int) o.len, o.buf);
+		r = 1;
+	}
+	edi_builder_destroy(b);
+	
+	if(NULL != (ref = (char *) malloc(3)))
+	{
+		memcpy(ref, "42X", 3);
+		memset(&o, 0, sizeof(o));
+		b = edi_builder_create(&edi_edifact_params, collect, &o);
+		seg = edi_builder_segment(b, "UNH");
+		edi_element_create_ref(seg, ref, 2);
+		edi_element_create(seg, "ORDERS");
+		if(0 != edi_builder_finish(b) || o.len != strlen(byref) || memcmp(o.buf, byref, o.len))
+		{
+			fprintf(stderr, "Output with a reference by length differs:\n%.*s\n", (int) o.len, o.buf);
+			r = 1;
+		}
+		edi_builder_destroy(b);
+		free(ref);
+	}
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	return r;
+}
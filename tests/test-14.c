@@ -0,0 +1,96 @@
+/* test-14: check that edi_interchange_build_iov() produces the same output
+ * as edi_interchange_build(), referring directly to long values which need
+ * no escaping.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libedi.h"
+
+const char edifact[] = 
+	"UNB+IATB:1+6XPPC+LHPPC+940101:0950+1'"
+	"UNH+1+PAORES:93:1:IA'"
+	"FTX+AAI+++THIS IS A LONG VALUE WITH NOTHING TO ESCAPE IN IT'"
+	"IFT+3+XYZCOMPANY AVAILABILITY?: PLEASE CALL?' BEFORE NOON TOMORROW'"
+	"UNT+4+1'"
+	"UNZ+1+1'";
+
+const char x12[] = 
+	"ISA:00:          :00:          :01:1515151515     :01:5151515151     :041201:1217:U:00304:000032123:0:P:*~"
+	"GS:CT:9988776655:1122334455:041201:1217:128:X:003040~"
+	"GE:1:128~"
+	"IEA:1:000032123~";
+
+static int
+check(const char *name, edi_interchange_t *i, const edi_params_t *params, const char *longvalue)
+{
+	char expect[1024], out[1024];
+	const struct iovec *vec;
+	size_t len, pos, count, c;
+	edi_iov_t *iov;
+	int r, found;
+	
+	r = 0;
+	len = edi_interchange_build(i, params, expect, sizeof(expect));
+	if(NULL == (iov = edi_interchange_build_iov(i, params)))
+	{
+		fprintf(stderr, "%s: edi_interchange_build_iov() failed\n", name);
+		return 1;
+	}
+	vec = edi_iov_vector(iov, &count);
+	found = 0;
+	for(c = 0, pos = 0; c < count && pos + vec[c].iov_len <= sizeof(out); c++)
+	{
+		memcpy(out + pos, vec[c].iov_base, vec[c].iov_len);
+		pos += vec[c].iov_len;
+		if(NULL != longvalue && vec[c].iov_base == (void *) longvalue)
+		{
+			found = 1;
+		}
+	}
+	if(pos != len || memcmp(expect, out, len))
+	{
+		fprintf(stderr, "%s: output differs:\n%.*s\n", name, (int) pos, out);
+		r = 1;
+	}
+	if(NULL != longvalue && !found)
+	{
+		fprintf(stderr, "%s: value was copied rather than referred to\n", name);
+		r = 1;
+	}
+	edi_iov_destroy(iov);
+	return r;
+}
+
+int
+main(int argc, char **argv)
+{
+	edi_params_t params;
+	edi_parser_t *p;
+	edi_interchange_t *i;
+	int r;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	p = edi_parser_create(NULL);
+	
+	i = edi_parser_parse_buf(p, edifact, sizeof(edifact) - 1);
+	r |= check("EDIFACT", i, NULL, i->segments[2].elements[4].simple.value);
+	params = *(edi_detect_get_params("UN/EDIFACT"));
+	params.segment_newline = "\r\n";
+	r |= check("EDIFACT with UNA and line breaks", i, &params, i->segments[2].elements[4].simple.value);
+	edi_interchange_destroy(i);
+	
+	i = edi_parser_parse_buf(p, x12, sizeof(x12) - 1);
+	r |= check("X12", i, edi_detect_get_params("ANSI X12"), NULL);
+	edi_interchange_destroy(i);
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	edi_parser_destroy(p);
+	
+	return r;
+}
@@ -0,0 +1,94 @@
+/* test-15: check that values of many lengths, with separators and release
+ * characters in every position, are escaped correctly when built and are
+ * recovered intact when parsed again.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libedi.h"
+
+#define NVALUES                        400
+
+static const char alphabet[] = "ABCDEFGHIJ0123456789 .:+?'";
+
+int
+main(int argc, char **argv)
+{
+	char values[NVALUES][96], expect[NVALUES * 200], *buf, *p;
+	edi_interchange_t *i, *o;
+	edi_parser_t *parser;
+	edi_segment_t *seg;
+	size_t c, d, len, size;
+	unsigned long seed;
+	int r;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	seed = 1;
+	i = edi_interchange_create();
+	p = expect;
+	for(c = 0; c < NVALUES; c++)
+	{
+		len = c % 90;
+		for(d = 0; d < len; d++)
+		{
+			seed = seed * 1103515245 + 12345;
+			/* Mostly plain text, with the occasional special */
+			values[c][d] = alphabet[(seed >> 16) % ((seed >> 8) % 7 ? 20 : sizeof(alphabet) - 1)];
+		}
+		values[c][len] = 0;
+		seg = edi_segment_create(i, "FTX");
+		edi_element_create(seg, values[c]);
+		p += sprintf(p, "FTX+");
+		for(d = 0; d < len; d++)
+		{
+			if(strchr(":+?'", values[c][d]))
+			{
+				*p++ = '?';
+			}
+			*p++ = values[c][d];
+		}
+		*p++ = '\'';
+	}
+	*p = 0;
+	size = edi_interchange_build_size(i, NULL);
+	buf = (char *) malloc(size + 1);
+	len = edi_interchange_build(i, NULL, buf, size + 1);
+	if(len != size || len != strlen(expect) || memcmp(buf, expect, len))
+	{
+		fprintf(stderr, "Generated output is not escaped as expected\n");
+		r = 1;
+	}
+	parser = edi_parser_create(NULL);
+	o = edi_parser_parse_buf(parser, buf, len);
+	if(NULL == o || NVALUES != o->nsegments)
+	{
+		fprintf(stderr, "Failed to parse generated output\n");
+		r = 1;
+	}
+	else
+	{
+		for(c = 0; c < NVALUES; c++)
+		{
+			d = (2 == o->segments[c].nelements ? o->segments[c].elements[1].simple.valuelen : 0);
+			if(strlen(values[c]) != d || (d && memcmp(values[c], o->segments[c].elements[1].simple.value, d)))
+			{
+				fprintf(stderr, "Value %lu was not recovered intact\n", (unsigned long) c);
+				r = 1;
+				break;
+			}
+		}
+	}
+	edi_interchange_destroy(o);
+	edi_parser_destroy(parser);
+	edi_interchange_destroy(i);
+	free(buf);
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	return r;
+}
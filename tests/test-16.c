@@ -0,0 +1,98 @@
+/* test-16: check that segments and elements keep their addresses once room
+ * has been reserved for them, that elements continue to refer to their
+ * segments when the segment list grows, and that large interchanges can be
+ * built and serialized.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libedi.h"
+
+#define NSEGMENTS 100000
+
+int
+main(int argc, char **argv)
+{
+	edi_interchange_t *i;
+	edi_segment_t *first, *seg;
+	edi_element_t *el;
+	char buf[64];
+	size_t c, len;
+	int r;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	i = edi_interchange_create();
+	if(!i || 0 != edi_interchange_reserve(i, NSEGMENTS))
+	{
+		fprintf(stderr, "edi_interchange_reserve() failed\n");
+		return 1;
+	}
+	first = edi_segment_create(i, "UNH");
+	if(!first || 0 != edi_segment_reserve(first, 100))
+	{
+		fprintf(stderr, "edi_segment_reserve() failed\n");
+		return 1;
+	}
+	el = edi_element_create(first, "1");
+	for(c = 0; c < 98; c++)
+	{
+		edi_element_create(first, "X");
+	}
+	if(first->nelements != 100 || el != &(first->elements[1]))
+	{
+		fprintf(stderr, "reserved elements moved\n");
+		r = 1;
+	}
+	for(c = 1; c < NSEGMENTS; c++)
+	{
+		sprintf(buf, "%lu", (unsigned long) c);
+		if(NULL == (seg = edi_segment_create(i, "FTX")) ||
+			NULL == edi_element_create(seg, buf))
+		{
+			fprintf(stderr, "failed to create segment %lu\n", (unsigned long) c);
+			return 1;
+		}
+	}
+	if(first != &(i->segments[0]))
+	{
+		fprintf(stderr, "reserved segments moved\n");
+		r = 1;
+	}
+	/* Growing beyond the reservation may move the segments */
+	for(c = 0; c < NSEGMENTS; c++)
+	{
+		seg = edi_segment_create(i, "UNT");
+		edi_element_create(seg, "2");
+	}
+	for(c = 0; c < i->nsegments; c++)
+	{
+		if(i->segments[c].elements[0].simple.segment != &(i->segments[c]) ||
+			i->segments[c].elements[i->segments[c].nelements - 1].simple.segment != &(i->segments[c]))
+		{
+			fprintf(stderr, "segment %lu: elements do not refer to it\n", (unsigned long) c);
+			r = 1;
+			break;
+		}
+	}
+	sprintf(buf, "%lu", (unsigned long) (NSEGMENTS - 1));
+	seg = &(i->segments[NSEGMENTS - 1]);
+	if(seg->nelements != 2 || strcmp(seg->tag, "FTX") || strcmp(seg->elements[1].simple.value, buf))
+	{
+		fprintf(stderr, "segment %lu has the wrong content\n", (unsigned long) (NSEGMENTS - 1));
+		r = 1;
+	}
+	len = edi_interchange_build_size(i, &edi_edifact_params);
+	if(len < (size_t) NSEGMENTS * 2 * 6)
+	{
+		fprintf(stderr, "serialized interchange is too short (%lu octets)\n", (unsigned long) len);
+		r = 1;
+	}
+	edi_interchange_destroy(i);
+	puts(r ? "FAIL" : "PASS");
+	return r;
+}
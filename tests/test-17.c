@@ -0,0 +1,63 @@
+/* test-17: check that values added with edi_element_create_ref() and
+ * edi_element_add_ref() refer to the caller's memory, need not be
+ * NUL-terminated, and are serialized (and escaped) like copied values.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libedi.h"
+
+const char expect[] = "UNH+1+ORDERS:D:96A'FTX+AAI+++SEVENTEEN?+ONE:X'";
+
+int
+main(int argc, char **argv)
+{
+	const char record[] = "ORDERSD96ASEVENTEEN+ONEXYZ";
+	char tag[] = "FTXZ";
+	edi_interchange_t *i;
+	edi_segment_t *seg;
+	edi_element_t *el;
+	char buf[128];
+	size_t len;
+	int r;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	i = edi_interchange_create();
+	seg = edi_segment_create(i, "UNH");
+	edi_element_create_ref(seg, "1", 1);
+	el = edi_element_create_ref(seg, record, 6);
+	edi_element_add_ref(el, record + 6, 1);
+	edi_element_add_ref(el, record + 7, 3);
+	seg = edi_segment_create(i, NULL);
+	edi_element_create_ref(seg, tag, 3);
+	edi_element_create_ref(seg, "AAI", 3);
+	edi_element_create_ref(seg, NULL, 0);
+	edi_element_create_ref(seg, NULL, 0);
+	el = edi_element_create_ref(seg, record + 10, 13);
+	edi_element_add(el, "X");
+	/* The tag is copied, and so unaffected by changes to the original */
+	tag[0] = 'Z';
+	if(strcmp(seg->tag, "FTX"))
+	{
+		fprintf(stderr, "tag was not copied\n");
+		r = 1;
+	}
+	if(el->composite.values[0] != record + 10 || el->composite.valuelens[0] != 13)
+	{
+		fprintf(stderr, "value was copied\n");
+		r = 1;
+	}
+	len = edi_interchange_build(i, NULL, buf, sizeof(buf));
+	if(len != strlen(expect) || memcmp(buf, expect, len) || len != edi_interchange_build_size(i, NULL))
+	{
+		fprintf(stderr, "unexpected output: %.*s\n", (int) len, buf);
+		r = 1;
+	}
+	edi_interchange_destroy(i);
+	puts(r ? "FAIL" : "PASS");
+	return r;
+}
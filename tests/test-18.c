@@ -0,0 +1,108 @@
+/* test-18: check that edi_interchange_build_parallel() produces the same
+ * output as edi_interchange_build() with any number of threads, including
+ * the service string header and when the buffer is too small.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libedi.h"
+
+#define NSEGMENTS 8000
+
+const char edifact[] = 
+	"UNB+IATB:1+6XPPC+LHPPC+940101:0950+1'"
+	"UNH+1+PAORES:93:1:IA'";
+
+const char x12[] = 
+	"ISA:00:          :00:          :01:1515151515     :01:5151515151     :041201:1217:U:00304:000032123:0:P:*~"
+	"GS:CT:9988776655:1122334455:041201:1217:128:X:003040~";
+
+static int
+check(const char *name, edi_interchange_t *i, const edi_params_t *params)
+{
+	char *expect, *out;
+	size_t size, len, n, lens[4];
+	unsigned int t;
+	int r;
+	
+	r = 0;
+	size = edi_interchange_build_size(i, params);
+	expect = (char *) malloc(size + 1);
+	out = (char *) malloc(size + 1);
+	edi_interchange_build(i, params, expect, size + 1);
+	lens[0] = size + 1;
+	lens[1] = size;
+	lens[2] = size / 3;
+	lens[3] = 10;
+	for(t = 0; t <= 6; t++)
+	{
+		for(n = 0; n < 4; n++)
+		{
+			memset(out, '#', size + 1);
+			len = edi_interchange_build_parallel(i, params, out, lens[n], t);
+			if(len != (lens[n] > size ? size : lens[n]) || memcmp(expect, out, len) ||
+				(lens[n] > size && out[len]) || (lens[n] <= size && '#' != out[lens[n]]))
+			{
+				fprintf(stderr, "%s: output with %u threads into %lu octets differs\n", name, t, (unsigned long) lens[n]);
+				r = 1;
+			}
+		}
+	}
+	free(expect);
+	free(out);
+	return r;
+}
+
+static void
+extend(edi_interchange_t *i)
+{
+	edi_segment_t *seg;
+	edi_element_t *el;
+	char buf[32];
+	size_t c;
+	
+	for(c = 0; c < NSEGMENTS; c++)
+	{
+		seg = edi_segment_create(i, "FTX");
+		sprintf(buf, "%lu", (unsigned long) c);
+		edi_element_create(seg, buf);
+		el = edi_element_create(seg, (c % 3 ? "PLAIN TEXT" : "SPECIALS:+?'*~"));
+		edi_element_add(el, buf);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	edi_params_t params;
+	edi_parser_t *p;
+	edi_interchange_t *i;
+	int r;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	p = edi_parser_create(NULL);
+	
+	i = edi_parser_parse_buf(p, edifact, sizeof(edifact) - 1);
+	extend(i);
+	r |= check("EDIFACT", i, NULL);
+	params = *(edi_detect_get_params("UN/EDIFACT"));
+	params.segment_newline = "\r\n";
+	r |= check("EDIFACT with UNA and line breaks", i, &params);
+	edi_interchange_destroy(i);
+	
+	i = edi_parser_parse_buf(p, x12, sizeof(x12) - 1);
+	extend(i);
+	r |= check("X12", i, edi_detect_get_params("ANSI X12"));
+	edi_interchange_destroy(i);
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	edi_parser_destroy(p);
+	
+	return r;
+}
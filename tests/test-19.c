@@ -0,0 +1,134 @@
+/* test-19: check that a transcoder produces the same output as parsing an
+ * interchange and building it with different parameters, however the input
+ * is divided.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libedi.h"
+
+const char edifact[] = 
+	"UNA*^.! \""
+	"UNB^IATB*1^6XPPC^LHPPC^940101*0950^1\""
+	"UNH^1^PAORES*93*1*IA\""
+	"FTX^AAI^^^PLUS+ COLON: QUOTE' QUESTION? STAR!* CARET!^ BANG!! DQUOTE!\"\""
+	"IFT^3^XYZCOMPANY AVAILABILITY!* PLEASE CALL\""
+	"UNT^4^1\""
+	"UNZ^1^1\"";
+
+const char x12[] = 
+	"ISA:00:          :00:          :01:1515151515     :01:5151515151     :041201:1217:U:00304:000032123:0:P:*~"
+	"GS:CT:9988776655:1122334455:041201:1217:128:X:003040~"
+	"BIN:12:AB~CD:EF*G'+~"
+	"N1:ST:ACME+CO'S*PART?:1~"
+	"GE:2:128~"
+	"IEA:1:000032123~";
+
+struct output
+{
+	char buf[2048];
+	size_t len;
+};
+
+static int
+collect(void *data, const char *buf, size_t len)
+{
+	struct output *out;
+	
+	out = (struct output *) data;
+	if(out->len + len > sizeof(out->buf))
+	{
+		return -1;
+	}
+	memcpy(out->buf + out->len, buf, len);
+	out->len += len;
+	return 0;
+}
+
+static int
+check(const char *name, edi_parser_t *p, const char *msg, const edi_params_t *params)
+{
+	edi_interchange_t *i;
+	edi_transcoder_t *t;
+	struct output out;
+	char expect[2048];
+	size_t len, step, pos, n;
+	int r, err;
+	
+	r = 0;
+	i = edi_parser_parse(p, msg);
+	len = edi_interchange_build(i, params, expect, sizeof(expect));
+	edi_interchange_destroy(i);
+	for(step = 1; step <= strlen(msg); step++)
+	{
+		out.len = 0;
+		t = edi_transcoder_create(p, params, collect, &out);
+		err = EDI_ERR_NONE;
+		for(pos = 0; pos < strlen(msg) && EDI_ERR_NONE == err; pos += n)
+		{
+			n = (strlen(msg) - pos < step ? strlen(msg) - pos : step);
+			err = edi_transcoder_feed(t, msg + pos, n);
+		}
+		if(EDI_ERR_NONE == err)
+		{
+			err = edi_transcoder_finish(t);
+		}
+		edi_transcoder_destroy(t);
+		if(EDI_ERR_NONE != err || out.len != len || memcmp(expect, out.buf, len))
+		{
+			fprintf(stderr, "%s: output in pieces of %lu octets differs (error %d):\n%.*s\n", name, (unsigned long) step, err, (int) out.len, out.buf);
+			r = 1;
+			break;
+		}
+	}
+	return r;
+}
+
+int
+main(int argc, char **argv)
+{
+	edi_params_t params;
+	edi_parser_t *p;
+	edi_transcoder_t *t;
+	struct output out;
+	int r;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	p = edi_parser_create(NULL);
+	
+	r |= check("EDIFACT to defaults", p, edifact, NULL);
+	r |= check("EDIFACT to EDIFACT", p, edifact, edi_detect_get_params("UN/EDIFACT"));
+	params = *(edi_detect_get_params("UN/EDIFACT"));
+	params.segment_newline = "\r\n";
+	r |= check("EDIFACT to EDIFACT with line breaks", p, edifact, &params);
+	r |= check("EDIFACT to X12", p, edifact, edi_detect_get_params("ANSI X12"));
+	r |= check("X12 to X12", p, x12, edi_detect_get_params("ANSI X12"));
+	r |= check("X12 to EDIFACT", p, x12, edi_detect_get_params("UN/EDIFACT"));
+	params = *(edi_detect_get_params("ANSI X12"));
+	params.segment_separator = '\n';
+	params.element_separator = '|';
+	params.tag_separator = '|';
+	r |= check("X12 to X12 with other separators", p, x12, &params);
+	
+	/* An incomplete segment is reported once the input is finished */
+	out.len = 0;
+	t = edi_transcoder_create(p, NULL, collect, &out);
+	edi_transcoder_feed(t, edifact, sizeof(edifact) - 4);
+	if(EDI_ERR_UNTERMINATED != edi_transcoder_finish(t))
+	{
+		fprintf(stderr, "incomplete segment was not reported\n");
+		r = 1;
+	}
+	edi_transcoder_destroy(t);
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	edi_parser_destroy(p);
+	
+	return r;
+}
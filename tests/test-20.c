@@ -0,0 +1,81 @@
+/* test-20: check that building a parsed interchange with splicing enabled
+ * copies unmodified segments exactly as they were received, serializes
+ * modified ones afresh, and has no effect when the separators differ.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libedi.h"
+
+const char edifact[] = 
+	"UNA:+.? '"
+	"UNB+UNOA:1+SENDER+RECIPIENT+940101:0950+1'"
+	"UNH+1+ORDERS:D:96A:UN'"
+	"FTX+AAI+++NEEDLESSLY ?E?S?C?A?P?E?D'"
+	"UNT+3+1'"
+	"UNZ+1+1'";
+
+const char changed[] = 
+	"UNA:+.? '"
+	"UNB+UNOA:1+SENDER+NEW?+RECIPIENT+940101:0950+1'"
+	"UNH+1+ORDERS:D:96A:UN'"
+	"FTX+AAI+++NEEDLESSLY ?E?S?C?A?P?E?D'"
+	"UNT+3+1'"
+	"UNZ+1+1'";
+
+int
+main(int argc, char **argv)
+{
+	const edi_params_t *params;
+	edi_parser_t *p;
+	edi_interchange_t *i;
+	char buf[512], expect[512];
+	size_t len;
+	int r;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	p = edi_parser_create(NULL);
+	params = edi_detect_get_params("UN/EDIFACT");
+	i = edi_parser_parse(p, edifact);
+	len = edi_interchange_build(i, params, buf, sizeof(buf));
+	if(len == strlen(edifact) && 0 == memcmp(buf, edifact, len))
+	{
+		fprintf(stderr, "segments were copied without splicing\n");
+		r = 1;
+	}
+	edi_interchange_splice(i, 1);
+	len = edi_interchange_build(i, params, buf, sizeof(buf));
+	if(len != strlen(edifact) || memcmp(buf, edifact, len) || len != edi_interchange_build_size(i, params))
+	{
+		fprintf(stderr, "unmodified interchange differs: %.*s\n", (int) len, buf);
+		r = 1;
+	}
+	edi_element_set(&(i->segments[0].elements[3]), "NEW+RECIPIENT");
+	len = edi_interchange_build(i, params, buf, sizeof(buf));
+	if(len != strlen(changed) || memcmp(buf, changed, len))
+	{
+		fprintf(stderr, "modified interchange differs: %.*s\n", (int) len, buf);
+		r = 1;
+	}
+	/* Segments cannot be copied if the separators differ */
+	params = edi_detect_get_params("ANSI X12");
+	len = edi_interchange_build(i, params, buf, sizeof(buf));
+	edi_interchange_splice(i, 0);
+	edi_interchange_build(i, params, expect, sizeof(expect));
+	if(strcmp(buf, expect))
+	{
+		fprintf(stderr, "interchange built with other separators differs: %s\n", buf);
+		r = 1;
+	}
+	edi_interchange_destroy(i);
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	edi_parser_destroy(p);
+	
+	return r;
+}
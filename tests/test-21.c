@@ -0,0 +1,187 @@
+/* test-21: check that a batching builder wraps messages, whether in tree
+ * form or pre-serialized, in numbered envelopes with the correct counts,
+ * and starts a new batch when the limits are reached.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libedi.h"
+
+#define NMESSAGES 7
+
+const char *noref =
+	"UNA:+.? '"
+	"UNB+UNOA:1+SENDER+RECIPIENT+940101:0950+'"
+	"UNH+3+ORDERS:D:96A:UN'BGM+220+3'UNT+3+3'"
+	"UNZ+1'";
+
+struct output
+{
+	char buf[4096];
+	size_t len;
+};
+
+static int
+collect(void *data, const char *buf, size_t len)
+{
+	struct output *out;
+	
+	out = (struct output *) data;
+	if(out->len + len > sizeof(out->buf))
+	{
+		return -1;
+	}
+	memcpy(out->buf + out->len, buf, len);
+	out->len += len;
+	return 0;
+}
+
+/* Add message @n in one of three forms */
+static int
+add(edi_builder_t *b, edi_parser_t *p, int n)
+{
+	edi_interchange_t *i;
+	char msg[128];
+	int r;
+	
+	switch(n % 3)
+	{
+		case 0:
+			/* Tree form, with the trailer left to the builder */
+			sprintf(msg, "UNH+%d+ORDERS:D:96A:UN'BGM+220+%d'", n, n);
+			i = edi_parser_parse(p, msg);
+			r = edi_builder_message(b, i);
+			edi_interchange_destroy(i);
+			return r;
+		case 1:
+			/* Serialized, with an incomplete trailer */
+			sprintf(msg, "UNH+%d+ORDERS:D:96A:UN'BGM+220+%d'UNT'", n, n);
+			break;
+		default:
+			/* Serialized in full, and not re-escaped */
+			sprintf(msg, "UNH+%d+ORDERS:D:96A:UN'BGM+220+%d'UNT+3+%d'", n, n, n);
+	}
+	return edi_builder_message_raw(b, msg, strlen(msg));
+}
+
+static int
+check(const char *name, edi_parser_t *p, edi_interchange_t *envelope, size_t maxmessages, size_t maxoctets)
+{
+	struct output out;
+	edi_builder_t *b;
+	char expect[4096], *e;
+	int r, n, c, batch;
+	
+	r = 0;
+	out.len = 0;
+	b = edi_builder_create(edi_detect_get_params("UN/EDIFACT"), collect, &out);
+	edi_builder_batch(b, envelope, 41);
+	edi_builder_batch_limits(b, maxmessages, maxoctets, 0);
+	for(n = 1; n <= NMESSAGES; n++)
+	{
+		if(0 != add(b, p, n))
+		{
+			fprintf(stderr, "%s: failed to add message %d\n", name, n);
+			r = 1;
+		}
+	}
+	if(0 != edi_builder_finish(b))
+	{
+		fprintf(stderr, "%s: edi_builder_finish() failed\n", name);
+		r = 1;
+	}
+	edi_builder_destroy(b);
+	if(!maxmessages)
+	{
+		maxmessages = 1;
+	}
+	e = expect;
+	for(n = 1, batch = 0; n <= NMESSAGES; n += (int) maxmessages, batch++)
+	{
+		e += sprintf(e, "UNA:+.? 'UNB+UNOA:1+SENDER+RECIPIENT+940101:0950+%08d'", 41 + batch);
+		for(c = 0; c < (int) maxmessages && n + c <= NMESSAGES; c++)
+		{
+			e += sprintf(e, "UNH+%d+ORDERS:D:96A:UN'BGM+220+%d'UNT+3+%d'", n + c, n + c, n + c);
+		}
+		e += sprintf(e, "UNZ+%d+%08d'", c, 41 + batch);
+	}
+	if(out.len != strlen(expect) || memcmp(out.buf, expect, out.len))
+	{
+		fprintf(stderr, "%s: output differs:\n%.*s\n", name, (int) out.len, out.buf);
+		r = 1;
+	}
+	return r;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct output out;
+	edi_builder_t *b;
+	edi_parser_t *p;
+	edi_interchange_t *envelope;
+	edi_segment_t *seg;
+	edi_element_t *el;
+	char *ref;
+	int r;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	p = edi_parser_create(edi_detect_get_params("UN/EDIFACT"));
+	envelope = edi_parser_parse(p, "UNB+UNOA:1+SENDER+RECIPIENT+940101:0950+00000001'");
+	
+	r |= check("Three messages per batch", p, envelope, 3, 0);
+	r |= check("One octet per batch", p, envelope, 0, 1);
+	
+	edi_interchange_destroy(envelope);
+	
+	/* An envelope whose control reference is empty is not renumbered */
+	envelope = edi_interchange_create();
+	seg = edi_segment_create(envelope, "UNB");
+	el = edi_element_create(seg, "UNOA");
+	edi_element_add(el, "1");
+	edi_element_create(seg, "SENDER");
+	edi_element_create(seg, "RECIPIENT");
+	el = edi_element_create(seg, "940101");
+	edi_element_add(el, "0950");
+	edi_element_create(seg, NULL);
+	out.len = 0;
+	b = edi_builder_create(edi_detect_get_params("UN/EDIFACT"), collect, &out);
+	edi_builder_batch(b, envelope, 41);
+	if(0 != add(b, p, 3) || 0 != edi_builder_finish(b) ||
+		out.len != strlen(noref) || memcmp(out.buf, noref, out.len))
+	{
+		fprintf(stderr, "Empty reference: output differs:\n%.*s\n", (int) out.len, out.buf);
+		r = 1;
+	}
+	edi_builder_destroy(b);
+	edi_interchange_destroy(envelope);
+	
+	/* An envelope control reference given by length keeps its width */
+	if(NULL != (ref = (char *) malloc(8)))
+	{
+		memcpy(ref, "00000001", 8);
+		envelope = edi_interchange_create();
+		seg = edi_segment_create(envelope, "UNB");
+		el = edi_element_create(seg, "UNOA");
+		edi_element_add(el, "1");
+		edi_element_create(seg, "SENDER");
+		edi_element_create(seg, "RECIPIENT");
+		el = edi_element_create(seg, "940101");
+		edi_element_add(el, "0950");
+		edi_element_create_ref(seg, ref, 8);
+		r |= check("Reference by length", p, envelope, 3, 0);
+		edi_interchange_destroy(envelope);
+		free(ref);
+	}
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	edi_parser_destroy(p);
+	
+	return r;
+}
@@ -0,0 +1,130 @@
+/* @(#) $Id$ */
+
+/*
+ * Copyright (c) 2003, 2004, 2005, 2006, 2007, 2008 Mo McRoberts.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) of this software may not be used to endorse
+ *    or promote products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY 
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * AUTHORS OF THIS SOFTWARE BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF 
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS 
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Serialise a message with a writer generated by edi-codegen from
+ * test-22.spec and check that the output is identical to that produced by
+ * building the equivalent interchange.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libedi.h"
+#include "test-22.h"
+
+static size_t
+build(const struct order *m, char *buf, size_t buflen)
+{
+	edi_params_t params;
+	edi_interchange_t *i;
+	edi_segment_t *seg;
+	edi_element_t *el;
+	char qty[32];
+	size_t len;
+	
+	/* The generated writer produces messages without a service string
+	 * header.
+	 */
+	params = *edi_detect_get_params("UN/EDIFACT");
+	params.ss_name = NULL;
+	params.ss_trailer = NULL;
+	i = edi_interchange_create();
+	seg = edi_segment_create(i, "UNH");
+	edi_element_create(seg, m->ref);
+	el = edi_element_create(seg, "ORDERS");
+	edi_element_add(el, "D");
+	edi_element_add(el, "96A");
+	edi_element_add(el, "UN");
+	seg = edi_segment_create(i, "BGM");
+	edi_element_create(seg, "220");
+	edi_element_create(seg, m->ref);
+	seg = edi_segment_create(i, "NAD");
+	edi_element_create(seg, "BY");
+	el = edi_element_create(seg, m->buyer);
+	edi_element_add(el, "");
+	edi_element_add(el, m->buyerqual);
+	seg = edi_segment_create(i, "QTY");
+	sprintf(qty, "%ld", m->quantity);
+	el = edi_element_create(seg, "21");
+	edi_element_add(el, qty);
+	edi_element_add(el, "PCE");
+	seg = edi_segment_create(i, "FTX");
+	edi_element_create(seg, "AAI");
+	edi_element_create(seg, "");
+	edi_element_create(seg, "");
+	el = edi_element_create(seg, m->text);
+	edi_element_add(el, "NO?CHANGE+");
+	len = edi_interchange_build(i, &params, buf, buflen);
+	edi_interchange_destroy(i);
+	return len;
+}
+
+int
+main(int argc, char **argv)
+{
+	static const struct order orders[] = {
+		{ "ME000001", "5412345000013", "9", 1200, "Deliver to gate 3" },
+		{ "ME+0002", "O'NEIL:CO", "92", -5, "Is it 50% off? Yes+no" },
+		{ "", "", "", 0, "" }
+	};
+	char buf[512], expect[512], small[16];
+	size_t c, len, elen;
+	int r;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	for(c = 0; c < sizeof(orders) / sizeof(orders[0]); c++)
+	{
+		len = test22_write_order(&orders[c], buf, sizeof(buf));
+		elen = build(&orders[c], expect, sizeof(expect));
+		if(len != elen || memcmp(buf, expect, len) || buf[len])
+		{
+			fprintf(stderr, "message %d differs:\n  %.*s\n  %.*s\n", (int) c, (int) len, buf, (int) elen, expect);
+			r = 1;
+		}
+		/* Output which doesn't fit is truncated, as by snprintf() */
+		memset(small, 'X', sizeof(small));
+		if(len != test22_write_order(&orders[c], small, sizeof(small) - 1) || memcmp(small, expect, sizeof(small) - 1) || 'X' != small[sizeof(small) - 1])
+		{
+			fprintf(stderr, "message %d was not truncated correctly\n", (int) c);
+			r = 1;
+		}
+	}
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	return r;
+}
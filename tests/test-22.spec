@@ -0,0 +1,22 @@
+# Message layout for test-22; see codegen/edi-codegen.c
+
+include "test-22.h"
+
+message test22_write_order struct order
+segment UNH
+element ref
+element "ORDERS":"D":"96A":"UN"
+segment BGM
+element "220"
+element ref
+segment NAD
+element "BY"
+element buyer:"":buyerqual
+segment QTY
+element "21":quantity#:"PCE"
+segment FTX
+element "AAI"
+element ""
+element ""
+element text:"NO?CHANGE+"
+end
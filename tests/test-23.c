@@ -0,0 +1,170 @@
+/* @(#) $Id$ */
+
+/*
+ * Copyright (c) 2003, 2004, 2005, 2006, 2007, 2008 Mo McRoberts.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) of this software may not be used to endorse
+ *    or promote products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY 
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * AUTHORS OF THIS SOFTWARE BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF 
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS 
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Look up segments by tag and qualifier using the segment index, both when
+ * it is built during parsing and when it is built on demand, and check that
+ * it follows segments being added and modified.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libedi.h"
+
+static const char *edifact = "UNB+UNOA:3+SENDER+RECIPIENT+081119:1200+1'"
+	"UNH+1+ORDERS:D:96A:UN'BGM+220+PO1'"
+	"NAD+BY+5412345000013::9'NAD+SU+4012345000094::9'NAD+DP+5412345000020::9'"
+	"LIN+1++4000862141404:SRS'QTY+21:48'LIN+2++4000862141411:SRS'QTY+21:12'"
+	"LIN+3++4000862141428:SRS'QTY+21:6'NAD+BY+DUPLICATE'"
+	"UNS+S'UNT+15+1'UNZ+1+1'";
+
+/* Check edi_interchange_find() against a linear search */
+static int
+check(edi_interchange_t *i, const char *tag, const char *qual, size_t expect)
+{
+	const size_t *indices;
+	const edi_segment_t *seg;
+	const edi_element_t *el;
+	const char *v;
+	size_t n, c, m;
+	
+	n = edi_interchange_find(i, tag, qual, &indices);
+	if(n != expect)
+	{
+		fprintf(stderr, "%s/%s: found %d segments, expected %d\n", tag, (qual ? qual : "*"), (int) n, (int) expect);
+		return 1;
+	}
+	for(c = 0, m = 0; c < i->nsegments; c++)
+	{
+		seg = &(i->segments[c]);
+		if(strcmp(seg->tag, tag))
+		{
+			continue;
+		}
+		if(NULL != qual)
+		{
+			if(seg->nelements < 2)
+			{
+				continue;
+			}
+			el = &(seg->elements[1]);
+			v = (EDI_ELEMENT_SIMPLE == el->type ? el->simple.value : el->composite.values[0]);
+			if(strcmp(v, qual))
+			{
+				continue;
+			}
+		}
+		if(m >= n || indices[m] != c)
+		{
+			fprintf(stderr, "%s/%s: segment %d is missing\n", tag, (qual ? qual : "*"), (int) c);
+			return 1;
+		}
+		m++;
+	}
+	if(n && edi_interchange_find_segment(i, tag, qual) != &(i->segments[indices[0]]))
+	{
+		fprintf(stderr, "%s/%s: edi_interchange_find_segment() differs\n", tag, (qual ? qual : "*"));
+		return 1;
+	}
+	return 0;
+}
+
+static int
+checkall(edi_interchange_t *i)
+{
+	int r;
+	
+	r = check(i, "LIN", NULL, 3);
+	r |= check(i, "NAD", NULL, 4);
+	r |= check(i, "NAD", "BY", 2);
+	r |= check(i, "NAD", "SU", 1);
+	r |= check(i, "QTY", "21", 3);
+	r |= check(i, "UNB", "UNOA", 1);
+	r |= check(i, "NAD", "XX", 0);
+	r |= check(i, "FTX", NULL, 0);
+	if(NULL != edi_interchange_find_segment(i, "FTX", NULL))
+	{
+		fprintf(stderr, "FTX: edi_interchange_find_segment() found a segment\n");
+		r = 1;
+	}
+	return r;
+}
+
+int
+main(int argc, char **argv)
+{
+	edi_params_t params;
+	edi_parser_t *p;
+	edi_interchange_t *i;
+	edi_segment_t *seg;
+	int r, pass;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	for(pass = 0; pass < 2; pass++)
+	{
+		/* Index during parsing on the second pass only */
+		params = *edi_detect_get_params("UN/EDIFACT");
+		params.index_segments = pass;
+		p = edi_parser_create(&params);
+		i = edi_parser_parse(p, edifact);
+		r |= checkall(i);
+		/* Segments added later are indexed */
+		seg = edi_segment_create(i, "NAD");
+		edi_element_create(seg, "SU");
+		r |= check(i, "NAD", NULL, 5);
+		r |= check(i, "NAD", "SU", 2);
+		/* Changing a qualifier is reflected */
+		edi_element_set(&(i->segments[3].elements[1]), "IV");
+		r |= check(i, "NAD", "BY", 1);
+		r |= check(i, "NAD", "IV", 1);
+		r |= check(i, "NAD", NULL, 5);
+		edi_interchange_destroy(i);
+		edi_parser_destroy(p);
+	}
+	/* Interchanges which were not parsed can be searched too */
+	i = edi_interchange_create();
+	edi_element_create(edi_segment_create(i, "LIN"), "1");
+	edi_element_create(edi_segment_create(i, "QTY"), "21");
+	edi_element_create(edi_segment_create(i, "LIN"), "2");
+	r |= check(i, "LIN", NULL, 2);
+	r |= check(i, "LIN", "2", 1);
+	edi_interchange_destroy(i);
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	return r;
+}
@@ -0,0 +1,131 @@
+/* @(#) $Id$ */
+
+/*
+ * Copyright (c) 2003, 2004, 2005, 2006, 2007, 2008 Mo McRoberts.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) of this software may not be used to endorse
+ *    or promote products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY 
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * AUTHORS OF THIS SOFTWARE BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF 
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS 
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Dispatch on the packed tag codes set by the parser and when segments are
+ * created, and check that they follow changes to the tag.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libedi.h"
+
+static const char *edifact = "UNB+UNOA:3+SENDER+RECIPIENT+081119:1200+1'"
+	"UNH+1+ORDERS:D:96A:UN'BGM+220+PO1'NAD+BY+5412345000013::9'"
+	"LIN+1++4000862141404:SRS'QTY+21:48'LIN+2++4000862141411:SRS'"
+	"UNT+7+1'UNZ+1+1'";
+
+int
+main(int argc, char **argv)
+{
+	edi_parser_t *p;
+	edi_interchange_t *i;
+	edi_segment_t *seg;
+	size_t c, nlin, nother;
+	int r;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	p = edi_parser_create(NULL);
+	i = edi_parser_parse(p, edifact);
+	nlin = 0;
+	nother = 0;
+	for(c = 0; c < i->nsegments; c++)
+	{
+		seg = &(i->segments[c]);
+		if(seg->tagcode != edi_tag_code(seg->tag))
+		{
+			fprintf(stderr, "segment %d (%s) has code %08lx\n", (int) c, seg->tag, seg->tagcode);
+			r = 1;
+		}
+		switch(seg->tagcode)
+		{
+			case EDI_TAG3('L', 'I', 'N'):
+				nlin++;
+				break;
+			case EDI_TAG3('U', 'N', 'B'):
+			case EDI_TAG3('U', 'N', 'H'):
+			case EDI_TAG3('B', 'G', 'M'):
+			case EDI_TAG3('N', 'A', 'D'):
+			case EDI_TAG3('Q', 'T', 'Y'):
+			case EDI_TAG3('U', 'N', 'T'):
+			case EDI_TAG3('U', 'N', 'Z'):
+				nother++;
+				break;
+			default:
+				fprintf(stderr, "segment %d (%s) was not dispatched\n", (int) c, seg->tag);
+				r = 1;
+		}
+	}
+	if(2 != nlin || 7 != nother)
+	{
+		fprintf(stderr, "dispatched %d LIN and %d other segments\n", (int) nlin, (int) nother);
+		r = 1;
+	}
+	/* Created segments, including those whose tags have no code */
+	seg = edi_segment_create(i, "N1");
+	if(EDI_TAG2('N', '1') != seg->tagcode || EDI_TAG4('N', '1', 0, 0) != edi_tag_code("N1"))
+	{
+		fprintf(stderr, "N1 has code %08lx\n", seg->tagcode);
+		r = 1;
+	}
+	seg = edi_segment_create(i, "LONGER");
+	if(EDI_TAG_NONE != seg->tagcode || EDI_TAG_NONE != edi_tag_code("") || EDI_TAG_NONE != edi_tag_code(NULL))
+	{
+		fprintf(stderr, "LONGER has code %08lx\n", seg->tagcode);
+		r = 1;
+	}
+	if(EDI_TAG_NONE != edi_segment_create(i, NULL)->tagcode)
+	{
+		fprintf(stderr, "a segment without a tag has a code\n");
+		r = 1;
+	}
+	/* Replacing the tag */
+	seg = &(i->segments[3]);
+	edi_element_set(&(seg->elements[0]), "FTX");
+	if(EDI_TAG3('F', 'T', 'X') != seg->tagcode)
+	{
+		fprintf(stderr, "replaced tag has code %08lx\n", seg->tagcode);
+		r = 1;
+	}
+	edi_interchange_destroy(i);
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	edi_parser_destroy(p);
+	
+	return r;
+}
@@ -0,0 +1,167 @@
+/* @(#) $Id$ */
+
+/*
+ * Copyright (c) 2003, 2004, 2005, 2006, 2007, 2008 Mo McRoberts.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) of this software may not be used to endorse
+ *    or promote products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY 
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * AUTHORS OF THIS SOFTWARE BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF 
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS 
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Navigate the containers recorded while parsing UN/EDIFACT and ANSI X12
+ * interchanges.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libedi.h"
+
+/* Two functional groups holding two and three messages, followed by a
+ * message outside any group which is never ended.
+ */
+static const char *edifact = "UNB+UNOA:3+SENDER+RECIPIENT+081119:1200+1'"
+	"UNG+ORDERS+S+R+081119:1200+1+UN+D:96A'"
+	"UNH+1+ORDERS:D:96A:UN'BGM+220+A'UNT+3+1'"
+	"UNH+2+ORDERS:D:96A:UN'BGM+220+B'UNT+3+2'"
+	"UNE+2+1'"
+	"UNG+INVOIC+S+R+081119:1200+2+UN+D:96A'"
+	"UNH+3+INVOIC:D:96A:UN'BGM+380+C'UNT+3+3'"
+	"UNH+4+INVOIC:D:96A:UN'BGM+380+D'UNT+3+4'"
+	"UNH+5+INVOIC:D:96A:UN'BGM+380+E'UNT+3+5'"
+	"UNE+3+2'"
+	"UNH+6+ORDERS:D:96A:UN'BGM+220+F'"
+	"UNZ+3+1'";
+
+static const char *x12 = "ISA*00*          *00*          *ZZ*SENDER         *ZZ*RECEIVER       *081119*1200*U*00401*000000001*0*P*:~"
+	"GS*PO*SENDER*RECEIVER*20081119*1200*1*X*004010~"
+	"ST*850*0001~BEG*00*SA*PO1**20081119~SE*3*0001~"
+	"ST*850*0002~BEG*00*SA*PO2**20081119~SE*3*0002~"
+	"GE*2*1~IEA*1*000000001~";
+
+static int
+check(const edi_interchange_t *i, const edi_group_t *g, const char *start, const char *end, const char *what)
+{
+	if(NULL == g)
+	{
+		fprintf(stderr, "%s: not found\n", what);
+		return 1;
+	}
+	if(strcmp(i->segments[g->start].tag, start) || (NULL == end ? (size_t) -1 != g->end : strcmp(i->segments[g->end].tag, end)))
+	{
+		fprintf(stderr, "%s: segments %d to %d\n", what, (int) g->start, (int) g->end);
+		return 1;
+	}
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	edi_parser_t *p;
+	edi_interchange_t *i;
+	const edi_group_t *g, *m;
+	size_t c;
+	int r;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	p = edi_parser_create(NULL);
+	i = edi_parser_parse(p, edifact);
+	if(1 != edi_interchange_ngroups(i, 0) || 2 != edi_interchange_ngroups(i, 1) || 6 != edi_interchange_ngroups(i, 2) ||
+		0 != edi_interchange_ngroups(i, 3) || NULL != edi_interchange_group(i, 2, 6))
+	{
+		fprintf(stderr, "wrong numbers of containers\n");
+		r = 1;
+	}
+	g = edi_interchange_group(i, 0, 0);
+	r |= check(i, g, "UNB", "UNZ", "interchange");
+	if(NULL == g || NULL != g->parent || 3 != g->nchildren)
+	{
+		fprintf(stderr, "interchange has the wrong parent or children\n");
+		r = 1;
+	}
+	else
+	{
+		r |= check(i, g->children[0], "UNG", "UNE", "first group");
+		r |= check(i, g->children[1], "UNG", "UNE", "second group");
+		r |= check(i, g->children[2], "UNH", NULL, "unterminated message");
+		if(g->children[1] != edi_interchange_group(i, 1, 1) || 3 != g->children[1]->nchildren ||
+			g->children[1]->children[2] != edi_interchange_group(i, 2, 4))
+		{
+			fprintf(stderr, "second group has the wrong children\n");
+			r = 1;
+		}
+	}
+	for(c = 0; NULL != (m = edi_interchange_group(i, 2, c)); c++)
+	{
+		/* The control reference identifies each message */
+		if(atoi(i->segments[m->start].elements[1].simple.value) != (int) c + 1 ||
+			strcmp(i->segments[m->start + 1].tag, "BGM") || edi_segment_group(&(i->segments[m->start + 1])) != m ||
+			edi_segment_group(&(i->segments[m->start])) != m)
+		{
+			fprintf(stderr, "message %d is wrong\n", (int) c);
+			r = 1;
+		}
+		if(c < 5 && edi_segment_group(&(i->segments[m->end])) != m)
+		{
+			fprintf(stderr, "message %d does not hold its end segment\n", (int) c);
+			r = 1;
+		}
+	}
+	if(NULL == (m = edi_interchange_group(i, 2, 3)) || m->parent != edi_interchange_group(i, 1, 1) || m->parent->parent != g)
+	{
+		fprintf(stderr, "fourth message has the wrong parents\n");
+		r = 1;
+	}
+	if(edi_segment_group(&(i->segments[i->nsegments - 1])) != g ||
+		NULL != edi_segment_group(edi_segment_create(i, "UNB")))
+	{
+		fprintf(stderr, "segments outside messages are in the wrong container\n");
+		r = 1;
+	}
+	edi_interchange_destroy(i);
+	
+	i = edi_parser_parse(p, x12);
+	if(1 != edi_interchange_ngroups(i, 0) || 1 != edi_interchange_ngroups(i, 1) || 2 != edi_interchange_ngroups(i, 2))
+	{
+		fprintf(stderr, "wrong numbers of X12 containers\n");
+		r = 1;
+	}
+	r |= check(i, edi_interchange_group(i, 0, 0), "ISA", "IEA", "X12 interchange");
+	r |= check(i, edi_interchange_group(i, 1, 0), "GS", "GE", "X12 group");
+	r |= check(i, edi_interchange_group(i, 2, 1), "ST", "SE", "X12 transaction set");
+	edi_interchange_destroy(i);
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	edi_parser_destroy(p);
+	
+	return r;
+}
@@ -0,0 +1,204 @@
+/* @(#) $Id$ */
+
+/*
+ * Copyright (c) 2003, 2004, 2005, 2006, 2007, 2008 Mo McRoberts.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) of this software may not be used to endorse
+ *    or promote products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY 
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * AUTHORS OF THIS SOFTWARE BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF 
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS 
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Compile a set of path queries and evaluate them over each message of an
+ * interchange, and over segments as a reader produces them.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libedi.h"
+
+static const char *edifact = "UNB+UNOA:3+SENDER+RECIPIENT+081119:1200+1'"
+	"UNH+1+ORDERS:D:96A:UN'BGM+220+PO1'DTM+4:20081101:102'DTM+137:20081119:102'"
+	"RFF+VN:V100'RFF+ON:ORD-1'NAD+BY+5412345000013::9'NAD+SU+4012345000094::9'"
+	"QTY+21:48'QTY+21:12'UNT+11+1'"
+	"UNH+2+ORDERS:D:96A:UN'BGM+220+PO?'2'RFF+ON:ORD-2'NAD+SU+4012345000095::92'"
+	"FTX+AAI+++FREE TEXT'UNT+6+2'"
+	"UNZ+2+1'";
+
+static const char *const paths[] = {
+	"DTM[137]/1:2",
+	"RFF[ON]/1:2",
+	"RFF[qualifier=VN]/1:2",
+	"BGM/2",
+	"NAD[BY]/2",
+	"NAD[1=SU][2:3=9]/2",
+	"UNH/2",
+	"FTX",
+	"QTY[21]/1:2",
+	"UNH/0",
+	"FTX/4:2"
+};
+
+#define NPATHS                         (sizeof(paths) / sizeof(paths[0]))
+
+/* Expected results for each message; NULL where nothing matches */
+static const char *const expect[2][NPATHS] = {
+	{ "20081119", "ORD-1", "V100", "PO1", "5412345000013", "4012345000094", "ORDERS", NULL, "48", "UNH", NULL },
+	{ NULL, "ORD-2", NULL, "PO'2", NULL, NULL, "ORDERS", "AAI", NULL, "UNH", NULL }
+};
+
+static const char *const bad[] = {
+	"", "[137]", "DTM[137", "DTM/1:0", "DTM/x", "DTM[1:0=A]", "DTM]", "DTM/1:2x",
+	"DTM[1][2][3][4][5]"
+};
+
+struct state
+{
+	const edi_query_t *query;
+	edi_result_t results[NPATHS];
+	char values[NPATHS][64];
+	size_t segno;
+};
+
+static int
+compare(const edi_result_t *results, const char *const *values, size_t msg)
+{
+	size_t c;
+	int r;
+	
+	r = 0;
+	for(c = 0; c < NPATHS; c++)
+	{
+		if(NULL == values[c] ? NULL != results[c].value :
+			(NULL == results[c].value || results[c].len != strlen(values[c]) || memcmp(results[c].value, values[c], results[c].len)))
+		{
+			fprintf(stderr, "message %d: %s: got '%.*s', expected '%s'\n", (int) msg + 1, paths[c],
+				(int) results[c].len, (results[c].value ? results[c].value : "(null)"), (values[c] ? values[c] : "(null)"));
+			r = 1;
+		}
+	}
+	return r;
+}
+
+/* Collect results over the whole interchange, copying values as the
+ * reader's segments are transient.
+ */
+static int
+segment(edi_reader_t *reader, const edi_segment_t *seg, void *data)
+{
+	struct state *st;
+	size_t c;
+	
+	(void) reader;
+	
+	st = (struct state *) data;
+	if(edi_query_segment(st->query, seg, st->segno, st->results))
+	{
+		for(c = 0; c < NPATHS; c++)
+		{
+			if(NULL != st->results[c].value && st->results[c].value != st->values[c])
+			{
+				memcpy(st->values[c], st->results[c].value, st->results[c].len);
+				st->values[c][st->results[c].len] = 0;
+				st->results[c].value = st->values[c];
+			}
+		}
+	}
+	st->segno++;
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	static struct state st;
+	edi_parser_t *p;
+	edi_interchange_t *i;
+	edi_reader_t *reader;
+	edi_query_t *q;
+	edi_result_t results[NPATHS];
+	const char *first[NPATHS];
+	size_t c, n, err;
+	int r;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	for(c = 0; c < sizeof(bad) / sizeof(bad[0]); c++)
+	{
+		err = 99;
+		if(NULL != (q = edi_query_compile(&bad[c], 1, &err)) || 0 != err)
+		{
+			fprintf(stderr, "'%s' was compiled\n", bad[c]);
+			r = 1;
+		}
+	}
+	if(NULL == (q = edi_query_compile(paths, NPATHS, &err)))
+	{
+		fprintf(stderr, "path %d could not be compiled\n", (int) err);
+		return 1;
+	}
+	p = edi_parser_create(NULL);
+	i = edi_parser_parse(p, edifact);
+	for(c = 0; c < 2; c++)
+	{
+		n = edi_query_run(q, i, edi_interchange_group(i, 2, c), results);
+		r |= compare(results, expect[c], c);
+		if(n != (c ? 5 : 9))
+		{
+			fprintf(stderr, "message %d: %d paths matched\n", (int) c + 1, (int) n);
+			r = 1;
+		}
+	}
+	if(0 != strcmp(i->segments[results[1].segment].elements[1].composite.values[1], "ORD-2"))
+	{
+		fprintf(stderr, "wrong segment index\n");
+		r = 1;
+	}
+	/* Over the whole interchange, the first match of each path wins */
+	for(c = 0; c < NPATHS; c++)
+	{
+		first[c] = (NULL != expect[0][c] ? expect[0][c] : expect[1][c]);
+	}
+	edi_query_run(q, i, NULL, results);
+	r |= compare(results, first, 2);
+	st.query = q;
+	reader = edi_reader_create(p, NULL);
+	edi_reader_feed(reader, edifact, strlen(edifact), segment, &st);
+	edi_reader_finish(reader, segment, &st);
+	edi_reader_destroy(reader);
+	r |= compare(st.results, first, 3);
+	edi_interchange_destroy(i);
+	edi_query_destroy(q);
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	edi_parser_destroy(p);
+	
+	return r;
+}
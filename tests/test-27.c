@@ -0,0 +1,168 @@
+/* @(#) $Id$ */
+
+/*
+ * Copyright (c) 2003, 2004, 2005, 2006, 2007, 2008 Mo McRoberts.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) of this software may not be used to endorse
+ *    or promote products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY 
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * AUTHORS OF THIS SOFTWARE BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF 
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS 
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Extract line items from a catalogue into columns, and check the layout
+ * of the offsets, values and validity bitmaps.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libedi.h"
+
+static const char *edifact = "UNB+UNOA:3+SENDER+RECIPIENT+081119:1200+1'"
+	"UNH+1+PRICAT:D:96A:UN'BGM+9+CAT1'QTY+21:999'"
+	"LIN+1++4000862141404:SRS'QTY+21:48'PRI+AAA:1.50'"
+	"LIN+2++4000862141411:SRS'PRI+AAA:2.75'QTY+21:12'QTY+21:13'"
+	"LIN+3++4000862141428:SRS'"
+	"UNS+S'UNT+10+1'"
+	"UNH+2+PRICAT:D:96A:UN'QTY+21:777'"
+	"LIN+1++4000862141435:SRS'PRI+AAB:9.99'PRI+AAA:3.00'QTY+21:6'"
+	"UNT+6+2'"
+	"UNZ+2+1'";
+
+static const char *const paths[] = {
+	"LIN/3:1",
+	"QTY[21]/1:2",
+	"PRI[AAA]/1:2"
+};
+
+#define NPATHS                         (sizeof(paths) / sizeof(paths[0]))
+#define NROWS                          4
+
+static const char *const expect[NROWS][NPATHS] = {
+	{ "4000862141404", "48", "1.50" },
+	{ "4000862141411", "12", "2.75" },
+	{ "4000862141428", NULL, NULL },
+	{ "4000862141435", "6", "3.00" }
+};
+
+static int
+check(const edi_columns_t *cols, size_t first, size_t nrows)
+{
+	const edi_column_t *col;
+	const char *v;
+	size_t c, row, nnull, len;
+	int r, valid;
+	
+	if(NULL == cols || cols->nrows != nrows || cols->ncolumns != NPATHS)
+	{
+		fprintf(stderr, "expected %d rows\n", (int) nrows);
+		return 1;
+	}
+	r = 0;
+	for(c = 0; c < NPATHS; c++)
+	{
+		col = &(cols->columns[c]);
+		if(col->offsets[0])
+		{
+			fprintf(stderr, "%s: first offset is %d\n", paths[c], (int) col->offsets[0]);
+			r = 1;
+		}
+		for(row = 0, nnull = 0; row < nrows; row++)
+		{
+			v = expect[first + row][c];
+			valid = (col->validity[row / 8] >> (row % 8)) & 1;
+			len = col->offsets[row + 1] - col->offsets[row];
+			if(NULL == v)
+			{
+				nnull++;
+			}
+			if(NULL == v ? (valid || len) : (!valid || len != strlen(v) || memcmp(col->data + col->offsets[row], v, len)))
+			{
+				fprintf(stderr, "%s: row %d is '%.*s'%s\n", paths[c], (int) (first + row), (int) len, col->data + col->offsets[row], (valid ? "" : " (null)"));
+				r = 1;
+			}
+		}
+		if(nnull != col->nnull)
+		{
+			fprintf(stderr, "%s: %d nulls\n", paths[c], (int) col->nnull);
+			r = 1;
+		}
+	}
+	return r;
+}
+
+int
+main(int argc, char **argv)
+{
+	edi_parser_t *p;
+	edi_interchange_t *i;
+	edi_columns_t *cols;
+	int r;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	p = edi_parser_create(NULL);
+	i = edi_parser_parse(p, edifact);
+	cols = edi_columns_extract(i, NULL, "LIN", paths, NPATHS);
+	r |= check(cols, 0, NROWS);
+	if(NULL != cols)
+	{
+		edi_columns_destroy(cols);
+	}
+	/* Just the second message */
+	cols = edi_columns_extract(i, edi_interchange_group(i, 2, 1), "LIN", paths, NPATHS);
+	r |= check(cols, 3, 1);
+	if(NULL != cols)
+	{
+		edi_columns_destroy(cols);
+	}
+	cols = edi_columns_extract(i, NULL, "FTX", paths, NPATHS);
+	r |= check(cols, 0, 0);
+	if(NULL != cols)
+	{
+		edi_columns_destroy(cols);
+	}
+	/* Rows are counted even without columns */
+	cols = edi_columns_extract(i, NULL, "LIN", paths, 0);
+	if(NULL == cols || NROWS != cols->nrows)
+	{
+		fprintf(stderr, "rows were not counted without columns\n");
+		r = 1;
+	}
+	if(NULL != cols)
+	{
+		edi_columns_destroy(cols);
+	}
+	edi_interchange_destroy(i);
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	edi_parser_destroy(p);
+	
+	return r;
+}
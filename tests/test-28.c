@@ -0,0 +1,226 @@
+/* @(#) $Id$ */
+
+/*
+ * Copyright (c) 2003, 2004, 2005, 2006, 2007, 2008 Mo McRoberts.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The names of the author(s) of this software may not be used to endorse
+ *    or promote products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, 
+ * INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY 
+ * AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL
+ * AUTHORS OF THIS SOFTWARE BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF 
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS 
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Parse with auto-detection and look up parameter sets from several threads
+ * while others register new dialects and partner profiles, and check that
+ * every parse succeeds.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef LIBEDI_USE_PTHREAD
+# include <pthread.h>
+#endif
+
+#include "libedi.h"
+
+#define NREADERS                       4
+#define NWRITERS                       2
+#define NREGISTER                      100
+#define NPARSES                        2000
+
+/* No UNA, so only the partner profile supplies the separators */
+static const char *partnermsg = "UNB+UNOA:1+ACME:14+RECIPIENT+940101:0950+1!UNZ+1+1!";
+static const char *edifactmsg = "UNA:+.? 'UNB+UNOA:1+SENDER+RECIPIENT'UNZ+1+1'";
+
+#ifdef LIBEDI_USE_PTHREAD
+
+static edi_parser_t *parser;
+
+/* Parse @msg and check that it yields @nsegments segments */
+static int
+parse(const char *msg, size_t nsegments)
+{
+	edi_interchange_t *i;
+	int e;
+	
+	i = edi_parser_parse_r(parser, msg, strlen(msg), &e);
+	if(NULL == i || EDI_ERR_NONE != e || nsegments != i->nsegments)
+	{
+		fprintf(stderr, "Failed to parse '%s'\n", msg);
+		edi_interchange_destroy(i);
+		return 1;
+	}
+	edi_interchange_destroy(i);
+	return 0;
+}
+
+/* Format the name, detector and message of dialect @n of writer @w */
+static void
+dialect(int w, int n, char *name, char *detectstr, char *msg)
+{
+	sprintf(name, "Writer %d dialect %d", w, n);
+	sprintf(detectstr, "UNB+UNOA:1+W%dD%d+", w, n);
+	sprintf(msg, "UNB+UNOA:1+W%dD%d+RECIPIENT!UNZ+1+1!", w, n);
+}
+
+static void *
+reader(void *arg)
+{
+	const edi_params_t *params;
+	char name[64], detectstr[64], msg[128];
+	int c, r;
+	
+	(void) arg;
+	
+	r = 0;
+	for(c = 0; c < NPARSES; c++)
+	{
+		r |= parse(edifactmsg, 2);
+		r |= parse(partnermsg, 2);
+		params = edi_detect_get_params("UN/EDIFACT");
+		if(NULL == params || '\'' != params->segment_separator)
+		{
+			fprintf(stderr, "Failed to look up UN/EDIFACT\n");
+			r = 1;
+		}
+		/* Once a dialect is visible, its detector must be too */
+		dialect(c % NWRITERS, (c / NWRITERS) % NREGISTER, name, detectstr, msg);
+		if(NULL != edi_detect_get(name))
+		{
+			r |= parse(msg, 2);
+		}
+	}
+	return r ? (void *) "FAIL" : NULL;
+}
+
+static void *
+writer(void *arg)
+{
+	edi_params_t params;
+	edi_detector_t detectors[2];
+	const edi_regparams_t *rp;
+	char name[64], detectstr[64], msg[128], sender[32];
+	int w, n, r;
+	
+	w = *((int *) arg);
+	r = 0;
+	memset(detectors, 0, sizeof(detectors));
+	for(n = 0; n < NREGISTER; n++)
+	{
+		dialect(w, n, name, detectstr, msg);
+		params = edi_edifact_params;
+		params.segment_separator = '!';
+		detectors[0].detectstr = detectstr;
+		if(NULL == (rp = edi_params_register_detect(name, &params, detectors)))
+		{
+			fprintf(stderr, "Failed to register '%s'\n", name);
+			r = 1;
+			continue;
+		}
+		sprintf(sender, "W%dP%d", w, n);
+		if(0 != edi_partner_register(sender, rp))
+		{
+			fprintf(stderr, "Failed to register partner '%s'\n", sender);
+			r = 1;
+		}
+		r |= parse(msg, 2);
+		/* The partner profile supplies the separators of a message
+		 * which no detector recognises.
+		 */
+		sprintf(msg, "UNB+UNOA:1+%s:14+RECIPIENT+940101:0950+1!UNZ+1+1!", sender);
+		r |= parse(msg, 2);
+	}
+	return r ? (void *) "FAIL" : NULL;
+}
+
+int
+main(int argc, char **argv)
+{
+	pthread_t threads[NREADERS + NWRITERS];
+	int ids[NWRITERS];
+	edi_params_t params;
+	const edi_regparams_t *rp;
+	void *result;
+	int c, r;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	params = edi_edifact_params;
+	params.segment_separator = '!';
+	rp = edi_params_register("ACME", &params);
+	if(NULL == rp || 0 != edi_partner_register("ACME", rp))
+	{
+		fprintf(stderr, "Failed to register partner profile\n");
+		r = 1;
+	}
+	parser = edi_parser_create(NULL);
+	for(c = 0; c < NWRITERS; c++)
+	{
+		ids[c] = c;
+	}
+	for(c = 0; c < NREADERS + NWRITERS; c++)
+	{
+		if(0 != (c < NREADERS ?
+			pthread_create(&(threads[c]), NULL, reader, NULL) :
+			pthread_create(&(threads[c]), NULL, writer, &(ids[c - NREADERS]))))
+		{
+			fprintf(stderr, "Failed to create thread %d\n", c);
+			return 1;
+		}
+	}
+	for(c = 0; c < NREADERS + NWRITERS; c++)
+	{
+		if(0 != pthread_join(threads[c], &result) || NULL != result)
+		{
+			r = 1;
+		}
+	}
+	edi_parser_destroy(parser);
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	return r;
+}
+
+#else /* LIBEDI_USE_PTHREAD */
+
+int
+main(int argc, char **argv)
+{
+	(void) argc;
+	(void) argv;
+	(void) partnermsg;
+	(void) edifactmsg;
+	
+	/* Without threads there is nothing to race */
+	puts("PASS");
+	
+	return 0;
+}
+
+#endif /* LIBEDI_USE_PTHREAD */
@@ -0,0 +1,76 @@
+/* test-4: parse an EDIFACT message with each segment on its own line,
+ * checking that the line breaks are not treated as part of the segment tags,
+ * and regenerate it with line breaks.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libedi.h"
+
+const char *msg = 
+	"UNA:+.? '\r\n"
+	"UNB+IATB:1+6XPPC+LHPPC+940101:0950+1'\r\n"
+	"UNH+1+PAORES:93:1:IA'\r\n"
+	"MSG+1:45'\r\n"
+	"IFT+3+XYZCOMPANY AVAILABILITY'\r\n"
+	"ERC+A7V:1:AMD'\r\n"
+	"IFT+3+NO MORE FLIGHTS'\r\n"
+	"ODI'\r\n"
+	"UNT+7+1'\r\n"
+	"UNZ+1+1'\r\n";
+
+const char *tags[] = {
+	"UNB", "UNH", "MSG", "IFT", "ERC", "IFT", "ODI", "UNT", "UNZ", NULL
+};
+
+int
+main(int argc, char **argv)
+{
+	char buf[2048];
+	edi_params_t params;
+	edi_parser_t *p;
+	edi_interchange_t *i;
+	size_t c;
+	int r;
+	
+	(void) argc;
+	(void) argv;
+	
+	params = *(edi_detect_get_params("UN/EDIFACT"));
+	params.segment_whitespace = "\r\n";
+	params.segment_newline = "\r\n";
+	
+	p = edi_parser_create(&params);
+	i = edi_parser_parse(p, msg);
+	r = 0;
+	for(c = 0; tags[c]; c++)
+	{
+		if(c >= i->nsegments || strcmp(tags[c], i->segments[c].tag))
+		{
+			fprintf(stderr, "Segment %u: expected tag '%s'\n", (unsigned int) c, tags[c]);
+			r = 1;
+		}
+	}
+	if(c != i->nsegments)
+	{
+		fprintf(stderr, "Expected %u segments, found %u\n", (unsigned int) c, (unsigned int) i->nsegments);
+		r = 1;
+	}
+	
+	edi_interchange_build(i, &params, buf, sizeof(buf));
+	
+	fprintf(stderr, "Source:\n%s\n", msg);
+	fprintf(stderr, "Generated:\n%s\n", buf);
+	if(strcmp(msg, buf))
+	{
+		fprintf(stderr, "Source and generated versions differ\n");
+		r = 1;
+	}
+	puts(r ? "FAIL" : "PASS");
+	edi_interchange_destroy(i);
+		
+	edi_parser_destroy(p);
+
+	return r;
+}
@@ -0,0 +1,112 @@
+/* test-5: parse an X12 interchange containing a BIN segment whose payload
+ * includes separators and a NUL byte, and check that the payload is returned
+ * intact and written back unchanged.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libedi.h"
+
+/* Input, Output */
+const char msg[] = 
+	"ISA:00:          :00:          :01:1515151515     :01:5151515151     :041201:1217:U:00304:000032123:0:P:*~"
+	"GS:CT:9988776655:1122334455:041201:1217:128:X:003040~"
+	"ST:831:00128001~"
+	"BIN:11:~A:B*C\0D~~E~"
+	"SE:3:00128001~"
+	"GE:1:128~"
+	"IEA:1:000032123~";
+
+const char payload[] = "~A:B*C\0D~~E";
+
+/* Binary segment lists which can be used neither to parse nor to build */
+const char *badbinary[] = {
+	"BIN",
+	"BIN:1,BDS:x",
+	"A:1,B:1,C:1,D:1,E:1,F:1,G:1,H:1,BIN:1",
+	NULL
+};
+
+int
+main(int argc, char **argv)
+{
+	char buf[2048];
+	edi_params_t params;
+	edi_parser_t *p, *bp;
+	edi_builder_t *b;
+	edi_interchange_t *i;
+	edi_segment_t *seg;
+	size_t c, len;
+	int r;
+	
+	(void) argc;
+	(void) argv;
+	
+	p = edi_parser_create(NULL);
+	i = edi_parser_parse_buf(p, msg, sizeof(msg) - 1);
+	r = 0;
+	if(EDI_ERR_NONE != edi_parser_error(p) || i->nsegments != 7)
+	{
+		fprintf(stderr, "Parsing failed (error %d, %u segments)\n", edi_parser_error(p), (unsigned int) i->nsegments);
+		r = 1;
+	}
+	else
+	{
+		seg = &(i->segments[3]);
+		if(strcmp(seg->tag, "BIN") || seg->nelements != 3 ||
+			seg->elements[2].type != EDI_ELEMENT_SIMPLE ||
+			seg->elements[2].simple.valuelen != sizeof(payload) - 1 ||
+			memcmp(seg->elements[2].simple.value, payload, sizeof(payload) - 1))
+		{
+			fprintf(stderr, "Binary payload was not parsed correctly\n");
+			r = 1;
+		}
+	}
+	
+	len = edi_interchange_build(i, edi_detect_get_params("ANSI X12"), buf, sizeof(buf));
+	if(len != sizeof(msg) - 1 || memcmp(msg, buf, len))
+	{
+		fprintf(stderr, "Source and generated versions differ\n");
+		r = 1;
+	}
+	
+	/* The parser and the emitter must agree on which lists are usable */
+	params = *(edi_detect_get_params("ANSI X12"));
+	params.binary_segments = "A:1,B:1,C:1,D:1,E:1,F:1,G:1,BIN:1";
+	if(NULL == (bp = edi_parser_create(&params)) ||
+		sizeof(msg) - 1 != edi_interchange_build(i, &params, buf, sizeof(buf)))
+	{
+		fprintf(stderr, "Eight binary segments were not accepted\n");
+		r = 1;
+	}
+	edi_parser_destroy(bp);
+	for(c = 0; NULL != badbinary[c]; c++)
+	{
+		params.binary_segments = badbinary[c];
+		if(NULL != (bp = edi_parser_create(&params)))
+		{
+			fprintf(stderr, "Parser accepted binary segments '%s'\n", badbinary[c]);
+			edi_parser_destroy(bp);
+			r = 1;
+		}
+		if(NULL != (b = edi_builder_create(&params, NULL, NULL)))
+		{
+			fprintf(stderr, "Builder accepted binary segments '%s'\n", badbinary[c]);
+			edi_builder_destroy(b);
+			r = 1;
+		}
+		if(0 != edi_interchange_build(i, &params, buf, sizeof(buf)) || buf[0] ||
+			0 != edi_interchange_build_size(i, &params))
+		{
+			fprintf(stderr, "Built with binary segments '%s'\n", badbinary[c]);
+			r = 1;
+		}
+	}
+	puts(r ? "FAIL" : "PASS");
+	edi_interchange_destroy(i);
+		
+	edi_parser_destroy(p);
+
+	return r;
+}
@@ -0,0 +1,79 @@
+/* test-6: check that edi_parser_parse_r() reports results without modifying
+ * the parser, and that edi_parser_error() reports the result of the last
+ * edi_parser_parse() call made with a given parser.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libedi.h"
+
+const char *good = 
+	"UNB+IATB:1+6XPPC+LHPPC+940101:0950+1'"
+	"UNZ+1+1'";
+
+const char *bad = 
+	"UNB+IATB:1+6XPPC+LHPPC+940101:0950+1'"
+	"UNZ+1+1";
+
+int
+main(int argc, char **argv)
+{
+	edi_parser_t *p, *q;
+	edi_interchange_t *i;
+	int r, e;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	p = edi_parser_create(NULL);
+	q = edi_parser_create(NULL);
+	
+	i = edi_parser_parse_r(p, bad, strlen(bad), &e);
+	if(EDI_ERR_UNTERMINATED != e || 2 != i->nsegments)
+	{
+		fprintf(stderr, "edi_parser_parse_r() did not report an unterminated segment\n");
+		r = 1;
+	}
+	edi_interchange_destroy(i);
+	i = edi_parser_parse_r(p, good, strlen(good), &e);
+	if(EDI_ERR_NONE != e || 2 != i->nsegments)
+	{
+		fprintf(stderr, "edi_parser_parse_r() failed to parse a valid message\n");
+		r = 1;
+	}
+	edi_interchange_destroy(i);
+	if(EDI_ERR_NONE != edi_parser_error(p))
+	{
+		fprintf(stderr, "edi_parser_parse_r() affected edi_parser_error()\n");
+		r = 1;
+	}
+	
+	i = edi_parser_parse(p, bad);
+	edi_interchange_destroy(i);
+	if(EDI_ERR_UNTERMINATED != edi_parser_error(p))
+	{
+		fprintf(stderr, "edi_parser_error() did not report an unterminated segment\n");
+		r = 1;
+	}
+	if(EDI_ERR_NONE != edi_parser_error(q))
+	{
+		fprintf(stderr, "edi_parser_error() reported an error for the wrong parser\n");
+		r = 1;
+	}
+	i = edi_parser_parse(q, "");
+	edi_interchange_destroy(i);
+	if(EDI_ERR_EMPTY != edi_parser_error(q))
+	{
+		fprintf(stderr, "edi_parser_error() did not report an empty message\n");
+		r = 1;
+	}
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	edi_parser_destroy(p);
+	edi_parser_destroy(q);
+
+	return r;
+}
@@ -0,0 +1,76 @@
+/* test-7: register a large number of dialects, each with its own detector,
+ * and check that each is recognised.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libedi.h"
+
+#define NDIALECTS                      500
+
+const char *separators = "!#$%&|";
+
+int
+main(int argc, char **argv)
+{
+	char name[32], detectstr[32], buf[128];
+	edi_params_t params;
+	edi_detector_t detectors[2];
+	edi_parser_t *p;
+	edi_interchange_t *i;
+	size_t c;
+	int r, e;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	memset(detectors, 0, sizeof(detectors));
+	for(c = 0; c < NDIALECTS; c++)
+	{
+		params = edi_edifact_params;
+		params.segment_separator = separators[c % strlen(separators)];
+		sprintf(name, "Partner %u", (unsigned int) c);
+		sprintf(detectstr, "UNB+UNOA:1+P%u+", (unsigned int) c);
+		detectors[0].detectstr = detectstr;
+		if(NULL == edi_params_register_detect(name, &params, detectors))
+		{
+			fprintf(stderr, "Failed to register '%s'\n", name);
+			r = 1;
+		}
+	}
+	/* A later detector with the same string must not take precedence */
+	params = edi_edifact_params;
+	detectors[0].detectstr = "UNB+UNOA:1+P7+";
+	edi_params_register_detect("Duplicate", &params, detectors);
+	
+	p = edi_parser_create(NULL);
+	for(c = 0; c < NDIALECTS; c++)
+	{
+		sprintf(buf, "UNB+UNOA:1+P%u+RECIPIENT%cUNZ+1+1%c", (unsigned int) c,
+			separators[c % strlen(separators)], separators[c % strlen(separators)]);
+		i = edi_parser_parse_r(p, buf, strlen(buf), &e);
+		if(EDI_ERR_NONE != e || 2 != i->nsegments || strcmp(i->segments[1].tag, "UNZ"))
+		{
+			fprintf(stderr, "Failed to detect dialect for '%s'\n", buf);
+			r = 1;
+		}
+		edi_interchange_destroy(i);
+	}
+	/* Built-in dialects must still be recognised */
+	strcpy(buf, "UNA:>.? 'UNB>UNOA:1>X>Y'UNZ>1>1'");
+	i = edi_parser_parse_r(p, buf, strlen(buf), &e);
+	if(EDI_ERR_NONE != e || 2 != i->nsegments || 4 != i->segments[0].nelements)
+	{
+		fprintf(stderr, "Failed to detect UN/EDIFACT for '%s'\n", buf);
+		r = 1;
+	}
+	edi_interchange_destroy(i);
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	edi_parser_destroy(p);
+
+	return r;
+}
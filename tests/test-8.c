@@ -0,0 +1,124 @@
+/* test-8: check that partner profiles registered against an interchange
+ * sender identifier are used in preference to detected separators.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libedi.h"
+
+/* No UNA, and a non-default segment separator and release character */
+const char *partnermsg = 
+	"UNB+UNOA:1+ACME:14+RECIPIENT+940101:0950+1!"
+	"UNH+1+PAORES:93:1:IA!"
+	"IFT+3+IT/!S ALL OVER!"
+	"UNT+3+1!"
+	"UNZ+1+1!";
+
+/* No UNA, but non-default element and sub-element separators */
+const char *othermsg = 
+	"UNB*UNOA>1*OTHER>14*RECIPIENT*940101>0950*1'"
+	"UNZ*1*1'";
+
+const char *shortmsg = 
+	"UNB+UNOA+SENDER+RECIPIENT'"
+	"UNZ+1+1'";
+
+const char *x12msg = 
+	"ISA:00:          :00:          :01:1515151515     :01:5151515151     :041201:1217:U:00304:000032123:0:P:*^"
+	"GS:CT:9988776655:1122334455:041201:1217:128:X:003040^"
+	"GE:1:128^"
+	"IEA:1:000032123^";
+
+int
+main(int argc, char **argv)
+{
+	edi_params_t params;
+	const edi_regparams_t *rp;
+	edi_parser_t *p;
+	edi_interchange_t *i;
+	char *buf;
+	int r, e;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	params = edi_edifact_params;
+	params.segment_separator = '!';
+	params.escape = '/';
+	rp = edi_params_register("ACME", &params);
+	if(NULL == rp || 0 != edi_partner_register("ACME", rp))
+	{
+		fprintf(stderr, "Failed to register partner profile\n");
+		r = 1;
+	}
+	params = *(edi_detect_get_params("ANSI X12"));
+	params.segment_separator = '^';
+	rp = edi_params_register("Supplier", &params);
+	if(NULL == rp || 0 != edi_partner_register("1515151515", rp))
+	{
+		fprintf(stderr, "Failed to register partner profile\n");
+		r = 1;
+	}
+	
+	p = edi_parser_create(NULL);
+	i = edi_parser_parse_r(p, partnermsg, strlen(partnermsg), &e);
+	if(EDI_ERR_NONE != e || 5 != i->nsegments || 3 != i->segments[2].nelements ||
+		strcmp("IT!S ALL OVER", i->segments[2].elements[2].simple.value))
+	{
+		fprintf(stderr, "Partner profile was not applied\n");
+		r = 1;
+	}
+	edi_interchange_destroy(i);
+	
+	i = edi_parser_parse_r(p, othermsg, strlen(othermsg), &e);
+	if(EDI_ERR_NONE != e || 2 != i->nsegments || 6 != i->segments[0].nelements ||
+		EDI_ELEMENT_COMPOSITE != i->segments[0].elements[2].type)
+	{
+		fprintf(stderr, "Separators were not detected from UNB\n");
+		r = 1;
+	}
+	edi_interchange_destroy(i);
+	
+	/* A UNB too short to hold the separators is not detected from, and
+	 * is not read beyond its end.
+	 */
+	buf = (char *) malloc(4);
+	memcpy(buf, "UNB'", 4);
+	i = edi_parser_parse_r(p, buf, 4, &e);
+	if(EDI_ERR_NONE != e || 1 != i->nsegments || strcmp("UNB", i->segments[0].tag))
+	{
+		fprintf(stderr, "Short UNB was not parsed\n");
+		r = 1;
+	}
+	edi_interchange_destroy(i);
+	free(buf);
+	
+	/* Without a sub-element separator following the syntax identifier,
+	 * the defaults are used.
+	 */
+	i = edi_parser_parse_r(p, shortmsg, strlen(shortmsg), &e);
+	if(EDI_ERR_NONE != e || 2 != i->nsegments || 4 != i->segments[0].nelements ||
+		EDI_ELEMENT_SIMPLE != i->segments[0].elements[1].type || strcmp("UNOA", i->segments[0].elements[1].simple.value))
+	{
+		fprintf(stderr, "Implausible separators were detected from UNB\n");
+		r = 1;
+	}
+	edi_interchange_destroy(i);
+	
+	i = edi_parser_parse_r(p, x12msg, strlen(x12msg), &e);
+	if(EDI_ERR_NONE != e || 4 != i->nsegments || strcmp("IEA", i->segments[3].tag))
+	{
+		fprintf(stderr, "X12 partner profile was not applied\n");
+		r = 1;
+	}
+	edi_interchange_destroy(i);
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	edi_parser_destroy(p);
+
+	return r;
+}
@@ -0,0 +1,135 @@
+/* test-9: check that parsing stops with the appropriate error when one of
+ * the parser's limits is reached, and that large interchanges and composites
+ * are otherwise parsed intact.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libedi.h"
+
+const char *msg = 
+	"UNB+IATB:1+6XPPC+LHPPC+940101:0950+1'"
+	"UNH+1+PAORES:93:1:IA'"
+	"IFT+3+XYZCOMPANY AVAILABILITY?: PLEASE CALL'"
+	"UNT+3+1'"
+	"UNZ+1+1'";
+
+static int
+check(const char *name, const edi_params_t *params, const char *message, int expect, size_t nsegments)
+{
+	edi_parser_t *p;
+	edi_interchange_t *i;
+	int e, r;
+	
+	r = 0;
+	p = edi_parser_create(params);
+	i = edi_parser_parse_r(p, message, strlen(message), &e);
+	if(NULL == i || expect != e || nsegments != i->nsegments)
+	{
+		fprintf(stderr, "%s: expected error %d with %lu segments, got error %d with %lu segments\n",
+			name, expect, (unsigned long) nsegments, e, (unsigned long) (i ? i->nsegments : 0));
+		r = 1;
+	}
+	edi_interchange_destroy(i);
+	edi_parser_destroy(p);
+	return r;
+}
+
+int
+main(int argc, char **argv)
+{
+	edi_params_t params;
+	edi_parser_t *p;
+	edi_interchange_t *i;
+	char *big, *s;
+	size_t c, d;
+	int r, e;
+	
+	(void) argc;
+	(void) argv;
+	
+	r = 0;
+	params = edi_edifact_params;
+	r |= check("unlimited", &params, msg, EDI_ERR_NONE, 5);
+	params.max_segments = 3;
+	r |= check("max_segments", &params, msg, EDI_ERR_SEGMENTS, 3);
+	params.max_segments = 0;
+	params.max_elements = 5;
+	r |= check("max_elements", &params, msg, EDI_ERR_ELEMENTS, 1);
+	params.max_elements = 0;
+	params.max_components = 3;
+	r |= check("max_components", &params, msg, EDI_ERR_COMPONENTS, 2);
+	params.max_components = 0;
+	params.max_value_length = 35;
+	r |= check("max_value_length", &params, msg, EDI_ERR_VALUELEN, 3);
+	params.max_value_length = 36;
+	r |= check("max_value_length", &params, msg, EDI_ERR_NONE, 5);
+	params.max_value_length = 0;
+	
+	/* 2000 segments, the last of which has 2000 components */
+	big = (char *) malloc(2000 * 8 + 2000 * 5 + 16);
+	s = big;
+	for(c = 0; c < 1999; c++)
+	{
+		s += sprintf(s, "FTX+%lu'", (unsigned long) c);
+	}
+	s += sprintf(s, "RFF+");
+	for(c = 0; c < 2000; c++)
+	{
+		s += sprintf(s, "%s%lu", (c ? ":" : ""), (unsigned long) c);
+	}
+	strcpy(s, "'");
+	
+	params.max_memory = 4096;
+	p = edi_parser_create(&params);
+	i = edi_parser_parse_r(p, big, strlen(big), &e);
+	if(EDI_ERR_MEMORY != e || 0 == i->nsegments || i->nsegments >= 2000)
+	{
+		fprintf(stderr, "max_memory: expected error %d with a partial interchange, got error %d with %lu segments\n",
+			EDI_ERR_MEMORY, e, (unsigned long) i->nsegments);
+		r = 1;
+	}
+	edi_interchange_destroy(i);
+	edi_parser_destroy(p);
+	params.max_memory = 0;
+	
+	p = edi_parser_create(&params);
+	i = edi_parser_parse_r(p, big, strlen(big), &e);
+	if(EDI_ERR_NONE != e || 2000 != i->nsegments)
+	{
+		fprintf(stderr, "failed to parse a large interchange\n");
+		r = 1;
+	}
+	else
+	{
+		for(c = 0; c < i->nsegments; c++)
+		{
+			for(d = 0; d < i->segments[c].nelements; d++)
+			{
+				if(i->segments[c].elements[d].simple.segment != &(i->segments[c]))
+				{
+					fprintf(stderr, "element %lu of segment %lu does not refer to its segment\n", (unsigned long) d, (unsigned long) c);
+					r = 1;
+					c = i->nsegments - 1;
+					break;
+				}
+			}
+		}
+		if(2000 != i->segments[1999].elements[1].composite.nvalues ||
+			strcmp("1999", i->segments[1999].elements[1].composite.values[1999]) ||
+			NULL != i->segments[1999].elements[1].composite.values[2000])
+		{
+			fprintf(stderr, "failed to parse a large composite\n");
+			r = 1;
+		}
+	}
+	edi_interchange_destroy(i);
+	edi_parser_destroy(p);
+	free(big);
+	
+	puts(r ? "FAIL" : "PASS");
+	
+	return r;
+}